@@ -0,0 +1,81 @@
+#include "Affinity.h"
+
+long affinity_packets = 0;
+long affinity_stolen = 0;
+
+t_affinity* create_affinity(int threads, long capacity) {
+	t_affinity* affinity = (t_affinity*)malloc(sizeof(t_affinity));
+	if (affinity == NULL) {
+		perror("Memory allocation failed (affinity)");
+		exit(EXIT_FAILURE);
+	}
+	affinity->threads = threads > 0 ? threads : 1;
+	affinity->capacity = capacity;
+	affinity->owner = (int*)malloc(sizeof(int) * (capacity > 0 ? capacity : 1));
+	affinity->order = (long*)malloc(sizeof(long) * (capacity > 0 ? capacity : 1));
+	affinity->queues = (t_affinity_queue*)aligned_alloc(64, sizeof(t_affinity_queue) * affinity->threads);
+	if (affinity->owner == NULL || affinity->order == NULL || affinity->queues == NULL) {
+		perror("Memory allocation failed (affinity)");
+		exit(EXIT_FAILURE);
+	}
+	for (int t = 0; t < affinity->threads; t++)
+		affinity->queues[t].head = affinity->queues[t].end = 0;
+	affinity->packets = affinity->stolen = 0;
+	return affinity;
+}
+
+void fill_affinity(t_affinity* affinity, long count) {
+	const int* owner = affinity->owner;
+	//counting sort by owner, the packets of a queue keep the order of the generator
+	int threads = affinity->threads;
+	for (int t = 0; t < threads; t++)
+		affinity->queues[t].end = 0;
+	for (long p = 0; p < count; p++)
+		affinity->queues[owner[p] % threads].end++;
+	long begin = 0;
+	for (int t = 0; t < threads; t++) {
+		affinity->queues[t].head = begin;
+		begin += affinity->queues[t].end;
+		affinity->queues[t].end = affinity->queues[t].head;
+	}
+	for (long p = 0; p < count; p++)
+		affinity->order[affinity->queues[owner[p] % threads].end++] = p;
+	affinity->packets += count;
+}
+
+static long take(t_affinity_queue* queue) {
+	long p;
+	#pragma omp atomic read
+	p = queue->head;
+	if (p >= queue->end)
+		return -1;
+	#pragma omp atomic capture
+	p = queue->head++;
+	return p < queue->end ? p : -1;
+}
+
+long next_affinity(t_affinity* affinity, int thread) {
+	int threads = affinity->threads;
+	long p = take(&affinity->queues[thread % threads]);
+	if (p >= 0)
+		return affinity->order[p];
+	//own queue is empty, the other queues are visited starting with the next thread
+	for (int i = 1; i < threads; i++) {
+		p = take(&affinity->queues[(thread + i) % threads]);
+		if (p >= 0) {
+			#pragma omp atomic update
+			affinity->stolen++;
+			return affinity->order[p];
+		}
+	}
+	return -1;
+}
+
+void free_affinity(t_affinity* affinity) {
+	affinity_packets = affinity->packets;
+	affinity_stolen = affinity->stolen;
+	free(affinity->owner);
+	free(affinity->order);
+	free(affinity->queues);
+	free(affinity);
+}
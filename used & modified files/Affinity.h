@@ -0,0 +1,39 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+//Owner-computes scheduling of one batch of packets for the dynamic model: every packet has an owner
+//thread given by the application (the row of Mx, the tile column of Mb, the part of the array of St),
+//so the same data goes to the same core in every batch. A thread runs the packets of its own queue
+//first and takes packets from the queues of the other threads only when its own one is empty.
+typedef struct {
+	long head; // next packet of the queue, taken by the owner and by the thieves alike
+	long end;
+	char padding[64 - 2 * sizeof(long)]; // one queue per cache line
+} t_affinity_queue;
+
+typedef struct {
+	int threads;
+	long capacity;
+	int* owner; // thread of every packet of the batch, set by the master before fill_affinity
+	long* order; // packets of the batch grouped by owner
+	t_affinity_queue* queues;
+	long packets; // packets and stolen packets of all batches so far
+	long stolen;
+} t_affinity;
+
+t_affinity* create_affinity(int threads, long capacity);
+//queues of the packets 0 .. count - 1 of the batch, called by one thread between the batches
+void fill_affinity(t_affinity* affinity, long count);
+//next packet for the thread, -1 - the batch is done
+long next_affinity(t_affinity* affinity, int thread);
+void free_affinity(t_affinity* affinity);
+
+//packets and stolen packets of the last run with affinity, for the reports
+extern long affinity_packets;
+extern long affinity_stolen;
+
+#endif
@@ -0,0 +1,53 @@
+#include "Energy.h"
+
+static int domain_count = -1; // -1 - domains not discovered yet
+static int domain_index[ENERGY_MAX_DOMAINS];
+static long long max_energy_uj[ENERGY_MAX_DOMAINS];
+
+static int read_counter(int domain, const char* name, long long* value) {
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/class/powercap/intel-rapl:%d/%s", domain, name);
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL)
+		return 0;
+	int ok = fscanf(fp, "%lld", value) == 1;
+	fclose(fp);
+	return ok;
+}
+
+static void discover_domains() {
+	domain_count = 0;
+	for (int domain = 0; domain < ENERGY_MAX_DOMAINS; domain++) {
+		long long energy, range;
+		if (read_counter(domain, "energy_uj", &energy) && read_counter(domain, "max_energy_range_uj", &range)) {
+			domain_index[domain_count] = domain;
+			max_energy_uj[domain_count] = range;
+			domain_count++;
+		}
+	}
+}
+
+void read_energy(t_energy_sample* sample) {
+	if (domain_count < 0)
+		discover_domains();
+	sample->domains = 0;
+	for (int i = 0; i < domain_count; i++) {
+		if (!read_counter(domain_index[i], "energy_uj", &sample->energy_uj[i]))
+			return;
+	}
+	sample->domains = domain_count;
+}
+
+double energy_between(const t_energy_sample* before, const t_energy_sample* after) {
+	if (before->domains == 0 || before->domains != after->domains)
+		return -1.0;
+	long long used = 0;
+	for (int i = 0; i < before->domains; i++) {
+		//the counter wraps around at max_energy_range_uj
+		if (after->energy_uj[i] >= before->energy_uj[i])
+			used += after->energy_uj[i] - before->energy_uj[i];
+		else
+			used += max_energy_uj[i] - before->energy_uj[i] + after->energy_uj[i];
+	}
+	return used / 1e6;
+}
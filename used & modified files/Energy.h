@@ -0,0 +1,18 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//Reads the package RAPL counters (/sys/class/powercap/intel-rapl:N), the same domains as script.sh
+#define ENERGY_MAX_DOMAINS 8
+
+typedef struct {
+	int domains; // 0 - RAPL is not available
+	long long energy_uj[ENERGY_MAX_DOMAINS];
+} t_energy_sample;
+
+void read_energy(t_energy_sample* sample);
+double energy_between(const t_energy_sample* before, const t_energy_sample* after); // joules, -1 if not available
+
+#endif
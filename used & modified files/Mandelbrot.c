@@ -1,64 +1,585 @@
-#include "Mandelbrot.h"
-
-int BUFFERSIZEMANDELBROT;
-int CHUNKCOUNTMANDELBROT;
-double re_min, re_max, im_min, im_max;
-int image_width, image_height;
-int max_iterations, block_size;
-
-long generate_new_input_Mandelbrot(t_input_mandelbrot* input) { // returned value: how many items generated
-
-	static int howmanygenerated = 0;
-	static int x = 0, y = 0;
-
-	//Sets the maximum number of chunks to generate this time
-	int max = BUFFERSIZEMANDELBROT;
-	if (BUFFERSIZEMANDELBROT > (CHUNKCOUNTMANDELBROT - howmanygenerated))
-		max = CHUNKCOUNTMANDELBROT - howmanygenerated;
-
-	//Divides image into smaller pieces block_size x block_size
-	int counter = 0;
-	for (counter = 0;counter < max;counter++) {
-		input[counter].block_x = x;
-		input[counter].block_y = y++;
-
-		howmanygenerated++;
-		if (y == image_height/block_size) {
-			x++;
-			y = 0;
-			if (x == image_width/block_size) {
-				break;
-			}
-		}
-	}
-
-	return counter;
-}
-
-void process_Mandelbrot(t_input_mandelbrot* packet, int** result_buffer) {
-
-	//Standard Mandelbrot set calculation
-	for (int dy = 0; dy < block_size; ++dy) {
-		for (int dx = 0; dx < block_size; ++dx) {
-			int px = packet->block_x * block_size + dx;
-			int py = packet->block_y * block_size + dy;
-
-			if (px >= image_width || py >= image_height)
-				continue;
-
-			double re = re_min + px * (re_max - re_min) / image_width;
-			double im = im_min + py * (im_max - im_min) / image_height;
-
-			double x = 0.0, y = 0.0;
-			int iter = 0;
-			while (x * x + y * y <= 4.0 && iter < max_iterations) {
-				double x_new = x * x - y * y + re;
-				y = 2 * x * y + im;
-				x = x_new;
-				++iter;
-			}
-
-			result_buffer[py][px] = iter;
-		}
-	}
-}
+#include "Mandelbrot.h"
+#include <string.h>
+
+int BUFFERSIZEMANDELBROT;
+int CHUNKCOUNTMANDELBROT;
+double re_min, re_max, im_min, im_max;
+int image_width, image_height;
+int max_iterations, block_size;
+int tiles_x, tiles_y;
+int* tile_schedule = NULL;
+t_tile_stream* tile_stream = NULL;
+t_tile_cache* tile_cache = NULL;
+t_progressive* progressive_sink = NULL;
+double* deep_orbit_re = NULL;
+double* deep_orbit_im = NULL;
+int deep_orbit_length;
+double deep_spacing_re, deep_spacing_im;
+long long deep_glitches;
+int kernel_precision;
+int selected_precision;
+int symmetry;
+int fractal;
+double julia_re, julia_im;
+int multibrot_degree;
+int mirrored_rows;
+
+static int howmanygenerated = 0;
+static int caching_tiles = 0;
+static int pixel_levels = 1; // levels of the progressive mode, every tile is generated once per level
+static int level_tiles; // tiles generated in every level
+static int mirror_axis = -1; // row py and row mirror_axis - py are mirror images, -1 - no symmetry
+static int mirror_first, mirror_last; // rows copied from their mirror images instead of being computed
+
+typedef struct {
+	long long key;
+	int tile;
+} t_tile_key;
+
+static int compare_tile_keys(const void* a, const void* b) {
+	const t_tile_key* ta = (const t_tile_key*)a;
+	const t_tile_key* tb = (const t_tile_key*)b;
+	if (ta->key != tb->key)
+		return ta->key < tb->key ? -1 : 1;
+	//equal keys keep the column order, so the schedule is deterministic
+	return ta->tile - tb->tile;
+}
+
+static long long morton_key(int x, int y) {
+	long long key = 0;
+	for (int bit = 0; bit < 31; bit++) {
+		key |= (long long)((x >> bit) & 1) << (2 * bit);
+		key |= (long long)((y >> bit) & 1) << (2 * bit + 1);
+	}
+	return key;
+}
+
+static long long hilbert_key(int x, int y, int n) { // n - side of the curve, power of two
+	long long key = 0;
+	for (int s = n / 2; s > 0; s /= 2) {
+		int rx = (x & s) > 0;
+		int ry = (y & s) > 0;
+		key += (long long)s * s * ((3 * rx) ^ ry);
+		//rotate the quadrant
+		if (ry == 0) {
+			if (rx == 1) {
+				x = s - 1 - x;
+				y = s - 1 - y;
+			}
+			int t = x;
+			x = y;
+			y = t;
+		}
+	}
+	return key;
+}
+
+typedef void (*t_row_kernel_mandelbrot)(int py, int px, int count, int stride, int limit, int* out);
+static void compute_row_double_Mandelbrot(int py, int px, int count, int stride, int limit, int* out);
+static void compute_row_Mandelbrot(int py, int px, int count, int stride, int limit, int* out);
+static t_row_kernel_mandelbrot row_kernel = compute_row_double_Mandelbrot;
+static t_row_kernel_mandelbrot double_kernel = compute_row_double_Mandelbrot; // double kernel of the selected fractal
+
+static long long preview_cost(int bx, int by, int preview_iterations) {
+	//Sparse low-iteration sampling of the tile, the sum of iterations approximates its cost
+	int samples = block_size < 4 ? block_size : 4;
+	long long cost = 0;
+	for (int sy = 0; sy < samples; sy++) {
+		for (int sx = 0; sx < samples; sx++) {
+			int px = bx * block_size + (2 * sx + 1) * block_size / (2 * samples);
+			int py = by * block_size + (2 * sy + 1) * block_size / (2 * samples);
+			if (px >= image_width) px = image_width - 1;
+			if (py >= image_height) py = image_height - 1;
+
+			int iter;
+			compute_row_Mandelbrot(py, px, 1, 1, preview_iterations, &iter);
+			cost += iter;
+		}
+	}
+	return cost;
+}
+
+static void tile_extent(int tile, int* px, int* py, int* width, int* height) {
+	*px = tile / tiles_y * block_size;
+	*py = tile % tiles_y * block_size;
+	//edge tiles are cut to the image
+	*width = image_width - *px < block_size ? image_width - *px : block_size;
+	*height = image_height - *py < block_size ? image_height - *py : block_size;
+}
+
+static void start_levels(void);
+
+static void prepare_mirror(int** result_buffer) {
+	//row py is at im_min + py * spacing, its mirror image -im is at row -2 * im_min / spacing - py
+	mirror_axis = -1;
+	mirrored_rows = 0;
+	//the Burning Ship and the Julia sets of non-real c are not symmetric about the real axis
+	if (!symmetry || result_buffer == NULL || selected_precision == 3 || fractal == 2 || (fractal == 1 && julia_im != 0.0))
+		return;
+	double axis = -2.0 * im_min * image_height / (im_max - im_min);
+	if (axis < 1.0 || axis > 2.0 * (image_height - 1) || fabs(axis - nearbyint(axis)) > 1e-9)
+		return;
+	mirror_axis = (int)nearbyint(axis);
+	//the rows past the axis are mirrored, the rest of a partially symmetric view is computed
+	mirror_first = mirror_axis / 2 + 1;
+	mirror_last = mirror_axis < image_height - 1 ? mirror_axis : image_height - 1;
+	mirrored_rows = mirror_last - mirror_first + 1;
+	if (mirrored_rows <= 0)
+		mirror_axis = -1;
+}
+
+static int mirrored_row(int py) {
+	return mirror_axis >= 0 && py >= mirror_first && py <= mirror_last;
+}
+
+static int level_row(int py, int step) {
+	//rows computed by the level of this pixel step: every step-th row, and the rows whose mirror image
+	//is a step-th row, so that fill_level_Mandelbrot finds every mirrored row
+	if (mirrored_row(py))
+		return 0;
+	if (py % step == 0)
+		return 1;
+	return mirror_axis >= 0 && mirrored_row(mirror_axis - py) && (mirror_axis - py) % step == 0;
+}
+
+void fill_level_Mandelbrot(int** result_buffer, int** image, int step) {
+	//every pixel gets the value of the computed pixel of the level above and to the left of it
+	for (int py = 0; py < image_height; py++) {
+		int row = py - py % step;
+		if (mirrored_row(row))
+			row = mirror_axis - row;
+		for (int px = 0; px < image_width; px++)
+			image[py][px] = result_buffer[row][px - px % step];
+	}
+}
+
+static void tile_cache_key(int tile, t_tile_cache_key* key) {
+	int px, py, width, height;
+	tile_extent(tile, &px, &py, &width, &height);
+	memset(key, 0, sizeof(t_tile_cache_key));
+	key->spacing_re = (re_max - re_min) / image_width;
+	key->spacing_im = (im_max - im_min) / image_height;
+	key->origin_re = llround(re_min / key->spacing_re * 1024.0) + 1024LL * px;
+	key->origin_im = llround(im_min / key->spacing_im * 1024.0) + 1024LL * py;
+	key->max_iterations = max_iterations;
+	key->kernel = KERNEL_VERSION_MANDELBROT * 16 + selected_precision;
+	key->fractal = fractal;
+	key->degree = fractal == 3 ? multibrot_degree : 2;
+	if (fractal == 1) {
+		key->julia_re = julia_re;
+		key->julia_im = julia_im;
+	}
+	key->width = width;
+	key->height = height;
+}
+
+void prepare_tiles_Mandelbrot(int** result_buffer, int order, int preview_iterations, int threadnum) {
+
+	select_kernel_Mandelbrot(kernel_precision);
+
+	//Edge tiles may be partial, process_Mandelbrot skips pixels outside the image
+	tiles_x = (image_width + block_size - 1) / block_size;
+	tiles_y = (image_height + block_size - 1) / block_size;
+	CHUNKCOUNTMANDELBROT = tiles_x * tiles_y;
+	howmanygenerated = 0;
+
+	free(tile_schedule);
+	tile_schedule = NULL;
+	//the deep zoom view is not exact in double, so its tiles are not cached
+	caching_tiles = tile_cache != NULL && result_buffer != NULL && selected_precision != 3;
+	prepare_mirror(result_buffer);
+	//0 - column order is generated on the fly
+	if (order == 0 && !caching_tiles && mirror_axis < 0) {
+		start_levels();
+		return;
+	}
+
+	t_tile_key* keys = (t_tile_key*)malloc(sizeof(t_tile_key) * CHUNKCOUNTMANDELBROT);
+	tile_schedule = (int*)malloc(sizeof(int) * CHUNKCOUNTMANDELBROT);
+	if (keys == NULL || tile_schedule == NULL) {
+		perror("Memory allocation failed (tile schedule)");
+		exit(EXIT_FAILURE);
+	}
+
+	int side = 1;
+	while (side < tiles_x || side < tiles_y)
+		side *= 2;
+
+	//tile index is column major (block_x * tiles_y + block_y), same as the default order
+	#pragma omp parallel for schedule(dynamic,16) num_threads(threadnum)
+	for (int tile = 0; tile < CHUNKCOUNTMANDELBROT; tile++) {
+		int bx = tile / tiles_y;
+		int by = tile % tiles_y;
+		keys[tile].tile = tile;
+		switch (order) {
+			case 1: keys[tile].key = -preview_cost(bx, by, preview_iterations); break; // heaviest first (LPT)
+			case 2: keys[tile].key = morton_key(bx, by); break;
+			case 3: keys[tile].key = hilbert_key(bx, by, side); break;
+			default: keys[tile].key = tile; break;
+		}
+	}
+	if (order != 0)
+		qsort(keys, CHUNKCOUNTMANDELBROT, sizeof(t_tile_key), compare_tile_keys);
+
+	//tiles of mirrored rows only are skipped, cached tiles go straight to the result buffer,
+	//only the misses are scheduled
+	int count = 0;
+	for (int i = 0; i < CHUNKCOUNTMANDELBROT; i++) {
+		int tile = keys[i].tile;
+		int px, py, width, height;
+		tile_extent(tile, &px, &py, &width, &height);
+		if (mirrored_row(py) && mirrored_row(py + height - 1))
+			continue;
+		if (caching_tiles) {
+			t_tile_cache_key key;
+			tile_cache_key(tile, &key);
+			//the pointer is only valid until the next lookup, so copy at once
+			const int* cached = lookup_cache_Mandelbrot(tile_cache, &key);
+			if (cached != NULL) {
+				for (int dy = 0; dy < height; dy++)
+					memcpy(&result_buffer[py + dy][px], cached + dy * block_size, sizeof(int) * width);
+				continue;
+			}
+		}
+		tile_schedule[count++] = tile;
+	}
+	CHUNKCOUNTMANDELBROT = count;
+	free(keys);
+	start_levels();
+}
+
+static void start_levels(void) {
+	//the tiles of every level are generated before the finer level, so a level finishes as early as possible
+	level_tiles = CHUNKCOUNTMANDELBROT;
+	pixel_levels = progressive_sink != NULL ? progressive_sink->levels : 1;
+	CHUNKCOUNTMANDELBROT = level_tiles * pixel_levels;
+	if (progressive_sink != NULL)
+		start_levels_Mandelbrot(progressive_sink, level_tiles);
+}
+
+void finish_tiles_Mandelbrot(int** result_buffer, int threadnum) {
+	//mirrored rows are copied from their mirror images
+	if (mirror_axis >= 0) {
+		#pragma omp parallel for schedule(static) num_threads(threadnum)
+		for (int py = mirror_first; py <= mirror_last; py++)
+			memcpy(result_buffer[py], result_buffer[mirror_axis - py], sizeof(int) * image_width);
+	}
+	//newly computed tiles are added to the cache
+	if (caching_tiles) {
+		int* tile_data = (int*)malloc(sizeof(int) * block_size * block_size);
+		if (tile_data == NULL) {
+			perror("Memory allocation failed (tile)");
+			exit(EXIT_FAILURE);
+		}
+		for (int i = 0; i < level_tiles; i++) {
+			int px, py, width, height;
+			t_tile_cache_key key;
+			tile_extent(tile_schedule[i], &px, &py, &width, &height);
+			tile_cache_key(tile_schedule[i], &key);
+			memset(tile_data, 0, sizeof(int) * block_size * block_size);
+			for (int dy = 0; dy < height; dy++)
+				memcpy(tile_data + dy * block_size, &result_buffer[py + dy][px], sizeof(int) * width);
+			store_cache_Mandelbrot(tile_cache, &key, tile_data);
+		}
+		free(tile_data);
+	}
+	free(tile_schedule);
+	tile_schedule = NULL;
+}
+
+void prepare_deep_Mandelbrot(__float128 view_re_min, __float128 view_re_max, __float128 view_im_min, __float128 view_im_max,
+	int width, int height, int iterations) {
+
+	//Reference orbit of the pixel in the middle of the image, computed once in quad precision
+	__float128 spacing_re = (view_re_max - view_re_min) / width;
+	__float128 spacing_im = (view_im_max - view_im_min) / height;
+	__float128 center_re = view_re_min + (width / 2) * spacing_re;
+	__float128 center_im = view_im_min + (height / 2) * spacing_im;
+	deep_spacing_re = (double)spacing_re;
+	deep_spacing_im = (double)spacing_im;
+	deep_glitches = 0;
+
+	free_deep_Mandelbrot();
+	deep_orbit_re = (double*)malloc(sizeof(double) * (iterations + 1));
+	deep_orbit_im = (double*)malloc(sizeof(double) * (iterations + 1));
+	if (deep_orbit_re == NULL || deep_orbit_im == NULL) {
+		perror("Memory allocation failed (reference orbit)");
+		exit(EXIT_FAILURE);
+	}
+
+	__float128 x = 0, y = 0;
+	int n = 0;
+	deep_orbit_re[0] = 0.0;
+	deep_orbit_im[0] = 0.0;
+	while (n < iterations) {
+		__float128 x_new = x * x - y * y + center_re;
+		y = 2 * x * y + center_im;
+		x = x_new;
+		++n;
+		deep_orbit_re[n] = (double)x;
+		deep_orbit_im[n] = (double)y;
+		if (x * x + y * y > 4)
+			break;
+	}
+	deep_orbit_length = n;
+}
+
+void free_deep_Mandelbrot() {
+	free(deep_orbit_re);
+	free(deep_orbit_im);
+	deep_orbit_re = NULL;
+	deep_orbit_im = NULL;
+}
+
+
+long generate_new_input_Mandelbrot(t_input_mandelbrot* input) { // returned value: how many items generated
+
+	//Sets the maximum number of chunks to generate this time
+	int max = BUFFERSIZEMANDELBROT;
+	if (BUFFERSIZEMANDELBROT > (CHUNKCOUNTMANDELBROT - howmanygenerated))
+		max = CHUNKCOUNTMANDELBROT - howmanygenerated;
+
+	//Divides image into smaller pieces block_size x block_size
+	//in the order prepared by prepare_tiles_Mandelbrot (column by column by default)
+	int counter = 0;
+	for (counter = 0;counter < max;counter++) {
+		int index = howmanygenerated % level_tiles;
+		int tile = tile_schedule != NULL ? tile_schedule[index] : index;
+		input[counter].block_x = tile / tiles_y;
+		input[counter].block_y = tile % tiles_y;
+		input[counter].level = howmanygenerated / level_tiles;
+
+		howmanygenerated++;
+	}
+
+	return counter;
+}
+
+static void compute_row_deep_Mandelbrot(int py, int px, int count, int stride, int limit, int* out) {
+
+	//Perturbation: every pixel iterates its double precision distance dz from the high precision
+	//reference orbit Z, z = Z + dz, dz' = 2*Z*dz + dz^2 + dc
+	double dci = (py - image_height / 2) * deep_spacing_im;
+	long long glitches = 0;
+	for (int i = 0; i < count; ++i) {
+		double dcr = (px + i * stride - image_width / 2) * deep_spacing_re;
+
+		double dzr = 0.0, dzi = 0.0;
+		int m = 0; // position on the reference orbit
+		int iter = 0;
+		while (iter < limit) {
+			if (m == deep_orbit_length) {
+				//reference orbit ended (escaped or too short), continue from its start, Z_0 = 0
+				dzr += deep_orbit_re[m];
+				dzi += deep_orbit_im[m];
+				m = 0;
+			}
+			double zr = deep_orbit_re[m], zi = deep_orbit_im[m];
+			double dzr_new = 2 * (zr * dzr - zi * dzi) + dzr * dzr - dzi * dzi + dcr;
+			dzi = 2 * (zr * dzi + zi * dzr) + 2 * dzr * dzi + dci;
+			dzr = dzr_new;
+			++m;
+			++iter;
+
+			zr = deep_orbit_re[m] + dzr;
+			zi = deep_orbit_im[m] + dzi;
+			double mag = zr * zr + zi * zi;
+			if (mag > 4.0)
+				break;
+			//glitch: the pixel got closer to 0 than to the reference, dz lost its precision
+			//rebase it on the start of the orbit with the full value of z
+			if (mag < dzr * dzr + dzi * dzi) {
+				dzr = zr;
+				dzi = zi;
+				m = 0;
+				++glitches;
+			}
+		}
+
+		out[i * stride] = iter;
+	}
+	if (glitches) {
+		#pragma omp atomic update
+			deep_glitches += glitches;
+	}
+}
+
+//Iteration steps of the fractal family, z = x + iy, xx = x * x, yy = y * y, c = cr + i ci.
+//Every step is straight-line code, selects instead of branches, so the lane loop stays vectorised.
+#define STEP_MANDELBROT(T, D, x, y, xx, yy, cr, ci, x_new, y_new) \
+	x_new = xx - yy + cr; \
+	y_new = (T)2.0 * x * y + ci;
+
+#define STEP_BURNING_SHIP(T, D, x, y, xx, yy, cr, ci, x_new, y_new) \
+	T xy = x * y; \
+	x_new = xx - yy + cr; \
+	y_new = (T)2.0 * (xy < (T)0.0 ? -xy : xy) + ci;
+
+//z^D by repeated multiplication, D is a constant or multibrot_degree for the generic kernel,
+//the same count for all lanes
+#define STEP_MULTIBROT(T, D, x, y, xx, yy, cr, ci, x_new, y_new) \
+	T pr = x, pi = y; \
+	for (int k = 1; k < (D); ++k) { \
+		T pr_new = pr * x - pi * y; \
+		pi = pr * y + pi * x; \
+		pr = pr_new; \
+	} \
+	x_new = pr + cr; \
+	y_new = pi + ci;
+
+//Escape time kernel specialised for one floating point type and one member of the fractal family.
+//Pixels are iterated in groups of MANDELBROT_LANES with a mask instead of a per-pixel while loop,
+//so the inner loop has no branches and is vectorised, float gets twice as many lanes per vector as double.
+//JULIA - the pixel is the starting point and c is fixed, otherwise the pixel is c and z starts at 0.
+//Computes count pixels of row py from column px, every stride-th pixel, out has the same stride.
+#define DEFINE_ROW_KERNEL_MANDELBROT(T, name, JULIA, STEP, D) \
+static void name(int py, int px, int count, int stride, int limit, int* out) { \
+	T im = (T)(im_min + py * (im_max - im_min) / image_height); \
+	T ci = JULIA ? (T)julia_im : im; \
+	for (int first = 0; first < count; first += MANDELBROT_LANES) { \
+		T cr[MANDELBROT_LANES], x[MANDELBROT_LANES], y[MANDELBROT_LANES]; \
+		int iter[MANDELBROT_LANES]; \
+		for (int l = 0; l < MANDELBROT_LANES; ++l) { \
+			T re = (T)(re_min + (px + (first + l) * stride) * (re_max - re_min) / image_width); \
+			/* unused lanes start outside of the escape radius */ \
+			cr[l] = JULIA ? (T)julia_re : first + l < count ? re : (T)4.0; \
+			x[l] = first + l < count ? (JULIA ? re : (T)0.0) : (T)4.0; \
+			y[l] = JULIA ? im : (T)0.0; \
+			iter[l] = 0; \
+		} \
+		/* a partial group iterates only its pixels */ \
+		int lanes = count - first < MANDELBROT_LANES ? count - first : MANDELBROT_LANES; \
+		for (int i = 0; i < limit; ++i) { \
+			int active = 0; \
+			_Pragma("omp simd reduction(+:active)") \
+			for (int l = 0; l < lanes; ++l) { \
+				T xx = x[l] * x[l], yy = y[l] * y[l]; \
+				int inside = xx + yy <= (T)4.0; \
+				T x_new, y_new; \
+				STEP(T, D, x[l], y[l], xx, yy, cr[l], ci, x_new, y_new) \
+				x[l] = inside ? x_new : x[l]; \
+				y[l] = inside ? y_new : y[l]; \
+				iter[l] += inside; \
+				active += inside; \
+			} \
+			if (active == 0) \
+				break; \
+		} \
+		for (int l = 0; l < MANDELBROT_LANES && first + l < count; ++l) \
+			out[(first + l) * stride] = iter[l]; \
+	} \
+}
+
+DEFINE_ROW_KERNEL_MANDELBROT(float, compute_row_float_Mandelbrot, 0, STEP_MANDELBROT, 2)
+DEFINE_ROW_KERNEL_MANDELBROT(double, compute_row_double_Mandelbrot, 0, STEP_MANDELBROT, 2)
+DEFINE_ROW_KERNEL_MANDELBROT(float, compute_row_float_julia_Mandelbrot, 1, STEP_MANDELBROT, 2)
+DEFINE_ROW_KERNEL_MANDELBROT(double, compute_row_double_julia_Mandelbrot, 1, STEP_MANDELBROT, 2)
+DEFINE_ROW_KERNEL_MANDELBROT(float, compute_row_float_ship_Mandelbrot, 0, STEP_BURNING_SHIP, 2)
+DEFINE_ROW_KERNEL_MANDELBROT(double, compute_row_double_ship_Mandelbrot, 0, STEP_BURNING_SHIP, 2)
+DEFINE_ROW_KERNEL_MANDELBROT(float, compute_row_float_multi3_Mandelbrot, 0, STEP_MULTIBROT, 3)
+DEFINE_ROW_KERNEL_MANDELBROT(double, compute_row_double_multi3_Mandelbrot, 0, STEP_MULTIBROT, 3)
+DEFINE_ROW_KERNEL_MANDELBROT(float, compute_row_float_multi4_Mandelbrot, 0, STEP_MULTIBROT, 4)
+DEFINE_ROW_KERNEL_MANDELBROT(double, compute_row_double_multi4_Mandelbrot, 0, STEP_MULTIBROT, 4)
+DEFINE_ROW_KERNEL_MANDELBROT(float, compute_row_float_multi_Mandelbrot, 0, STEP_MULTIBROT, multibrot_degree)
+DEFINE_ROW_KERNEL_MANDELBROT(double, compute_row_double_multi_Mandelbrot, 0, STEP_MULTIBROT, multibrot_degree)
+
+//Float and double kernels of every fractal, degrees 3 and 4 of the Multibrot set have their own kernels
+static const t_row_kernel_mandelbrot fractal_kernels[6][2] = {
+	{ compute_row_float_Mandelbrot, compute_row_double_Mandelbrot },
+	{ compute_row_float_julia_Mandelbrot, compute_row_double_julia_Mandelbrot },
+	{ compute_row_float_ship_Mandelbrot, compute_row_double_ship_Mandelbrot },
+	{ compute_row_float_multi_Mandelbrot, compute_row_double_multi_Mandelbrot },
+	{ compute_row_float_multi3_Mandelbrot, compute_row_double_multi3_Mandelbrot },
+	{ compute_row_float_multi4_Mandelbrot, compute_row_double_multi4_Mandelbrot },
+};
+
+static void compute_row_Mandelbrot(int py, int px, int count, int stride, int limit, int* out) {
+	row_kernel(py, px, count, stride, limit, out);
+}
+
+int select_kernel_Mandelbrot(int precision) {
+	//0 - auto: float as long as one pixel spans enough float ulps of the largest coordinate
+	if (deep_orbit_re != NULL)
+		precision = 3;
+	else if (precision == 0) {
+		double spacing = fmax((re_max - re_min) / image_width, (im_max - im_min) / image_height);
+		double magnitude = fmax(fmax(fabs(re_min), fabs(re_max)), fmax(fabs(im_min), fabs(im_max)));
+		precision = spacing >= magnitude * FLOAT_SPACING_MANDELBROT ? 1 : 2;
+	}
+	int family = fractal;
+	if (fractal == 3 && (multibrot_degree == 3 || multibrot_degree == 4))
+		family = multibrot_degree + 1;
+	double_kernel = fractal_kernels[family][1];
+	switch (precision) {
+		case 1: row_kernel = fractal_kernels[family][0]; break;
+		case 3: row_kernel = compute_row_deep_Mandelbrot; break;
+		default: row_kernel = double_kernel; precision = 2; break;
+	}
+	selected_precision = precision;
+	return precision;
+}
+
+double validate_precision_Mandelbrot(int** result_buffer, int stride, int threadnum, double* within) {
+	//Recomputes every stride-th pixel of every stride-th row in double precision
+	//returns the fraction of identical iteration counts, within - fraction that differs by at most 1%
+	long long same = 0, close = 0, total = 0;
+	#pragma omp parallel for schedule(dynamic,1) reduction(+:same,close,total) num_threads(threadnum)
+	for (int py = 0; py < image_height; py += stride) {
+		int iter;
+		for (int px = 0; px < image_width; px += stride) {
+			double_kernel(py, px, 1, 1, max_iterations, &iter);
+			int diff = abs(iter - result_buffer[py][px]);
+			same += diff == 0;
+			close += diff <= max_iterations / 100;
+			total++;
+		}
+	}
+	*within = total ? (double)close / total : 1.0;
+	return total ? (double)same / total : 1.0;
+}
+
+int owner_Mandelbrot(const t_input_mandelbrot* packet, int threads) {
+	//a tile column is written by one thread, the columns of neighbouring tiles meet in the same rows
+	return packet->block_x % threads;
+}
+
+void process_Mandelbrot(t_input_mandelbrot* packet, int** result_buffer) {
+
+	int px = packet->block_x * block_size;
+	int py = packet->block_y * block_size;
+	//edge tiles are cut to the image
+	int width = image_width - px < block_size ? image_width - px : block_size;
+	int height = image_height - py < block_size ? image_height - py : block_size;
+
+	if (tile_stream != NULL) {
+		//streaming mode, the tile goes to the writer thread instead of the result buffer
+		int slot;
+		int* tile = acquire_tile_Mandelbrot(tile_stream, &slot);
+		if (width < block_size || height < block_size)
+			memset(tile, 0, sizeof(int) * block_size * block_size);
+		for (int dy = 0; dy < height; ++dy)
+			compute_row_Mandelbrot(py + dy, px, width, 1, max_iterations, tile + dy * block_size);
+		submit_tile_Mandelbrot(tile_stream, slot, packet->block_x * tiles_y + packet->block_y);
+		return;
+	}
+
+	//every step-th pixel of the rows of this level, the pixels of the previous level are skipped
+	int step = 1 << (pixel_levels - 1 - packet->level);
+	int previous = packet->level > 0 ? 2 * step : 0;
+	for (int dy = 0; dy < height; ++dy) {
+		int row = py + dy;
+		if (!level_row(row, step))
+			continue;
+		int stride = step;
+		int first = (px + step - 1) / step * step;
+		if (previous && level_row(row, previous)) {
+			//odd multiples of step only
+			stride = previous;
+			first = (px + step + previous - 1) / previous * previous - step;
+		}
+		if (first < px + width)
+			compute_row_Mandelbrot(row, first, (px + width - first + stride - 1) / stride, stride, max_iterations, &result_buffer[row][first]);
+	}
+	if (progressive_sink != NULL)
+		tile_level_done_Mandelbrot(progressive_sink, packet->level);
+}
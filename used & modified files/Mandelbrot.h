@@ -1,23 +1,56 @@
-#ifndef MANDELBROT_H
-#define MANDELBROT_H
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <omp.h>
-#include <math.h>
-
-extern int BUFFERSIZEMANDELBROT; //Size of buffer for dynamic model
-extern int CHUNKCOUNTMANDELBROT; //Number of chunks to process
-extern double re_min, re_max, im_min, im_max; 
-extern int image_width, image_height;
-extern int max_iterations, block_size;
-
-typedef struct {
-    int block_x;
-    int block_y;
-} t_input_mandelbrot;
-
-long generate_new_input_Mandelbrot(t_input_mandelbrot* input);
-void process_Mandelbrot(t_input_mandelbrot* data, int** result_buffer);
-
+#ifndef MANDELBROT_H
+#define MANDELBROT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <math.h>
+#include "MandelbrotStream.h"
+#include "MandelbrotCache.h"
+#include "MandelbrotProgressive.h"
+
+extern int BUFFERSIZEMANDELBROT; //Size of buffer for dynamic model
+extern int CHUNKCOUNTMANDELBROT; //Number of chunks to process
+extern double re_min, re_max, im_min, im_max; 
+extern int image_width, image_height;
+extern int max_iterations, block_size;
+extern int tiles_x, tiles_y; //Number of tiles in each direction, edge tiles can be partial
+extern int* tile_schedule; //Order of tiles to generate, NULL - column by column
+extern t_tile_stream* tile_stream; //Streaming mode sink, NULL - tiles are stored in the result buffer
+extern t_tile_cache* tile_cache; //Cache of computed tiles, NULL - every tile is computed
+extern t_progressive* progressive_sink; //Progressive mode, NULL - every tile is computed at full resolution at once
+extern double* deep_orbit_re, * deep_orbit_im; //Reference orbit of the deep zoom mode, NULL - plain double precision
+extern int deep_orbit_length; //Last valid index of the reference orbit
+extern double deep_spacing_re, deep_spacing_im; //Pixel spacing of the deep zoom mode
+extern long long deep_glitches; //Number of rebased pixels in the deep zoom mode
+extern int kernel_precision; //Requested precision: 0 - auto, 1 - float, 2 - double
+extern int selected_precision; //Precision of the kernel in use: 1 - float, 2 - double, 3 - deep zoom
+extern int symmetry; //1 - rows mirrored about the real axis are copied instead of computed
+extern int mirrored_rows; //Number of rows copied from their mirror images in the last render
+extern int fractal; //0 - Mandelbrot, 1 - Julia, 2 - Burning Ship, 3 - Multibrot
+extern double julia_re, julia_im; //Constant c of the Julia set
+extern int multibrot_degree; //Degree d of the Multibrot set z^d + c
+
+#define MANDELBROT_LANES 16 //Pixels iterated together by one row kernel step
+#define KERNEL_VERSION_MANDELBROT 1 //Bump when the kernels change their results, invalidates cached tiles
+#define FLOAT_SPACING_MANDELBROT (1.0 / 4096) //Auto precision uses float when pixel spacing / largest coordinate is at least this
+
+typedef struct {
+    int block_x;
+    int block_y;
+    int level; // level of the progressive mode, 0 - otherwise
+} t_input_mandelbrot;
+
+void prepare_tiles_Mandelbrot(int** result_buffer, int order, int preview_iterations, int threadnum);
+void finish_tiles_Mandelbrot(int** result_buffer, int threadnum);
+void fill_level_Mandelbrot(int** result_buffer, int** image, int step);
+void prepare_deep_Mandelbrot(__float128 view_re_min, __float128 view_re_max, __float128 view_im_min, __float128 view_im_max,
+	int width, int height, int iterations);
+void free_deep_Mandelbrot();
+int select_kernel_Mandelbrot(int precision);
+double validate_precision_Mandelbrot(int** result_buffer, int stride, int threadnum, double* within);
+long generate_new_input_Mandelbrot(t_input_mandelbrot* input);
+int owner_Mandelbrot(const t_input_mandelbrot* packet, int threads);
+void process_Mandelbrot(t_input_mandelbrot* data, int** result_buffer);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "MandelbrotAnimation.h"
+#include "MandelbrotImage.h"
+#include "Energy.h"
+#include <string.h>
+#include <quadmath.h>
+#include <pthread.h>
+
+#define FRAME_BUFFERS 2 // frame N+1 is rendered while frame N is written
+
+typedef struct {
+	int** buffers[FRAME_BUFFERS];
+	int frame[FRAME_BUFFERS]; // frame waiting for the writer in the buffer, -1 - buffer is free
+	int frames;
+	int failed; // frames the writer could not save
+	const char* output;
+	int format;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} t_frame_pool;
+
+static t_keyframe* load_keyframes(const char* path, int* count) {
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror("fopen");
+		return NULL;
+	}
+	int capacity = 16;
+	t_keyframe* keys = (t_keyframe*)malloc(sizeof(t_keyframe) * capacity);
+	if (keys == NULL) {
+		perror("Memory allocation failed (keyframes)");
+		exit(EXIT_FAILURE);
+	}
+	*count = 0;
+	char line[512];
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char* text[3];
+		text[0] = strtok(line, " \t\r\n");
+		if (text[0] == NULL || text[0][0] == '#')
+			continue;
+		text[1] = strtok(NULL, " \t\r\n");
+		text[2] = strtok(NULL, " \t\r\n");
+		if (text[1] == NULL || text[2] == NULL) {
+			printf("Bad keyframe %d in %s\n", *count + 1, path);
+			fclose(fp);
+			free(keys);
+			return NULL;
+		}
+		if (*count == capacity) {
+			capacity *= 2;
+			keys = (t_keyframe*)realloc(keys, sizeof(t_keyframe) * capacity);
+			if (keys == NULL) {
+				perror("Memory allocation failed (keyframes)");
+				exit(EXIT_FAILURE);
+			}
+		}
+		keys[*count].center_re = strtoflt128(text[0], NULL);
+		keys[*count].center_im = strtoflt128(text[1], NULL);
+		keys[*count].radius = strtoflt128(text[2], NULL);
+		(*count)++;
+	}
+	fclose(fp);
+	if (*count == 0) {
+		printf("No keyframes in %s\n", path);
+		free(keys);
+		return NULL;
+	}
+	return keys;
+}
+
+static void frame_view(const t_keyframe* keys, int count, int frame, int frames, double aspect, __float128 view[4]) {
+	//position of the frame on the keyframe path
+	__float128 t = frames > 1 ? (__float128)frame * (count - 1) / (frames - 1) : 0;
+	int segment = (int)t;
+	if (segment >= count - 1)
+		segment = count > 1 ? count - 2 : 0;
+	__float128 f = count > 1 ? t - segment : 0;
+	const t_keyframe* a = &keys[segment];
+	const t_keyframe* b = &keys[count > 1 ? segment + 1 : 0];
+
+	__float128 center_re = a->center_re + (b->center_re - a->center_re) * f;
+	__float128 center_im = a->center_im + (b->center_im - a->center_im) * f;
+	__float128 radius = a->radius * expq(logq(b->radius / a->radius) * f);
+
+	view[0] = center_re - radius;
+	view[1] = center_re + radius;
+	view[2] = center_im - radius * aspect;
+	view[3] = center_im + radius * aspect;
+}
+
+static int valid_pattern(const char* pattern) {
+	//exactly one %d conversion, optionally with zero padding and width
+	const char* p = strchr(pattern, '%');
+	if (p == NULL)
+		return 0;
+	p++;
+	while (*p >= '0' && *p <= '9')
+		p++;
+	return *p == 'd' && strchr(p, '%') == NULL;
+}
+
+static void* frame_writer(void* arg) {
+	t_frame_pool* pool = (t_frame_pool*)arg;
+	char filename[1024];
+
+	for (int frame = 0; frame < pool->frames; frame++) {
+		int buffer = frame % FRAME_BUFFERS;
+		pthread_mutex_lock(&pool->lock);
+		while (pool->frame[buffer] != frame)
+			pthread_cond_wait(&pool->changed, &pool->lock);
+		pthread_mutex_unlock(&pool->lock);
+
+		//colourise and write on this thread while the team renders the next frame
+		int error = 0;
+		if (pool->output != NULL) {
+			snprintf(filename, sizeof(filename), pool->output, frame);
+			error = save_image_Mandelbrot(filename, pool->buffers[buffer], pool->format, 1) != 0;
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		pool->failed += error;
+		pool->frame[buffer] = -1;
+		pthread_cond_broadcast(&pool->changed);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return NULL;
+}
+
+int animateMandelbrot(SettingsMandelbrot settings) {
+	if (settings.output != NULL && !valid_pattern(settings.output)) {
+		printf("Animation output has to be a pattern with one %%d, for example frame%%04d.ppm\n");
+		exit(0);
+	}
+	int keyframe_count;
+	t_keyframe* keys = load_keyframes(settings.path, &keyframe_count);
+	if (keys == NULL) {
+		exit(EXIT_FAILURE);
+	}
+
+	//one result buffer pool for the whole sequence
+	t_frame_pool pool;
+	pool.frames = settings.frames;
+	pool.failed = 0;
+	pool.output = settings.output;
+	pool.format = settings.format;
+	for (int b = 0; b < FRAME_BUFFERS; b++) {
+		pool.frame[b] = -1;
+		pool.buffers[b] = allocate_image_Mandelbrot(settings.image_width, settings.image_height, settings.thread_num);
+	}
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.changed, NULL);
+	pthread_t writer;
+	if (pthread_create(&writer, NULL, frame_writer, &pool) != 0) {
+		perror("pthread_create");
+		exit(EXIT_FAILURE);
+	}
+
+	double aspect = (double)settings.image_height / settings.image_width;
+	double total_energy = 0.0;
+	int energy_available = 1;
+	t_energy_sample energy_start, energy_frame, energy_now;
+	double time_start = omp_get_wtime();
+	double time_frame = time_start;
+	read_energy(&energy_start);
+	energy_frame = energy_start;
+
+	printf("frame, render_time, frame_time, frame_energy\n");
+	for (int frame = 0; frame < settings.frames; frame++) {
+		int buffer = frame % FRAME_BUFFERS;
+		//wait until the writer is done with the frame that used this buffer before
+		pthread_mutex_lock(&pool.lock);
+		while (pool.frame[buffer] != -1)
+			pthread_cond_wait(&pool.changed, &pool.lock);
+		pthread_mutex_unlock(&pool.lock);
+
+		__float128 view[4];
+		frame_view(keys, keyframe_count, frame, settings.frames, aspect, view);
+		settings.re_min = (double)view[0];
+		settings.re_max = (double)view[1];
+		settings.im_min = (double)view[2];
+		settings.im_max = (double)view[3];
+		if (settings.deep) {
+			prepare_deep_Mandelbrot(view[0], view[1], view[2], view[3],
+				settings.image_width, settings.image_height, settings.max_iterations);
+		}
+
+		double render_start = omp_get_wtime();
+		switch (settings.model) {
+			case 0: dynamicForMandelbrot(pool.buffers[buffer], settings); break;
+			case 1: taskingMandelbrot(pool.buffers[buffer], settings); break;
+			case 2: integratedMasterMandelbrot(pool.buffers[buffer], settings); break;
+			default: printf("Bad model\n"); break;
+		}
+		double render_time = omp_get_wtime() - render_start;
+
+		pthread_mutex_lock(&pool.lock);
+		pool.frame[buffer] = frame;
+		pthread_cond_broadcast(&pool.changed);
+		pthread_mutex_unlock(&pool.lock);
+
+		//a frame lasts from its start to the start of the next one, the last one until the writer is done
+		if (frame == settings.frames - 1)
+			pthread_join(writer, NULL);
+		double now = omp_get_wtime();
+		read_energy(&energy_now);
+		double energy = energy_between(&energy_frame, &energy_now);
+		if (energy < 0) {
+			energy_available = 0;
+			printf("%d, %.6f, %.6f, n/a\n", frame, render_time, now - time_frame);
+		}
+		else {
+			total_energy += energy;
+			printf("%d, %.6f, %.6f, %.6f\n", frame, render_time, now - time_frame, energy);
+		}
+		time_frame = now;
+		energy_frame = energy_now;
+	}
+	if (settings.frames < 1)
+		pthread_join(writer, NULL);
+	free_deep_Mandelbrot();
+
+	double total_time = omp_get_wtime() - time_start;
+	printf("Frames          : %d\n", settings.frames);
+	printf("Total time      : %.6f s\n", total_time);
+	printf("Frames per sec. : %.3f\n", settings.frames / total_time);
+	if (energy_available && settings.frames > 0) {
+		printf("Total energy    : %.6f J\n", total_energy);
+		printf("Frames per joule: %.6f\n", settings.frames / total_energy);
+	}
+	else {
+		printf("Total energy    : n/a (RAPL counters not available)\n");
+	}
+	if (pool.failed > 0)
+		printf("Failed frames   : %d of %d could not be saved\n", pool.failed, settings.frames);
+
+	pthread_mutex_destroy(&pool.lock);
+	pthread_cond_destroy(&pool.changed);
+	for (int b = 0; b < FRAME_BUFFERS; b++) {
+		for (int i = 0; i < settings.image_height; i++) {
+			free(pool.buffers[b][i]);
+		}
+		free(pool.buffers[b]);
+	}
+	free(keys);
+	return pool.failed > 0 ? -1 : 0;
+}
@@ -0,0 +1,17 @@
+#ifndef MANDELBROTANIMATION_H
+#define MANDELBROTANIMATION_H
+#include "MandelbrotMasterSlave.h"
+
+//Keyframe file: one keyframe per line "center_re center_im radius", radius is half of the real range.
+//Lines starting with # are skipped. Keyframes are spread evenly over the frames, the center moves
+//linearly and the radius geometrically between them.
+typedef struct {
+	__float128 center_re;
+	__float128 center_im;
+	__float128 radius;
+} t_keyframe;
+
+//Returns -1 if a frame could not be saved, the run itself still renders all frames
+int animateMandelbrot(SettingsMandelbrot settings);
+
+#endif
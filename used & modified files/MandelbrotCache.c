@@ -0,0 +1,200 @@
+#include "MandelbrotCache.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static unsigned long long hash_key(const t_tile_cache_key* key) {
+	//FNV-1a over the key bytes, keys are always zero filled before use
+	const unsigned char* bytes = (const unsigned char*)key;
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < sizeof(t_tile_cache_key); i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static size_t slot_size(t_tile_cache* cache) {
+	return sizeof(t_tile_cache_key) + sizeof(int) * cache->block_size * cache->block_size;
+}
+
+static unsigned char* disk_slot(t_tile_cache* cache, unsigned long long hash) {
+	return cache->map + CACHE_HEADER_SIZE_MANDELBROT + slot_size(cache) * (hash % cache->disk_slots);
+}
+
+static void open_disk_level(t_tile_cache* cache, const char* filename) {
+	cache->map_size = CACHE_HEADER_SIZE_MANDELBROT + slot_size(cache) * cache->disk_slots;
+	cache->fd = open(filename, O_RDWR | O_CREAT, 0644);
+	if (cache->fd < 0) {
+		perror("open");
+		exit(EXIT_FAILURE);
+	}
+	unsigned char header[CACHE_HEADER_SIZE_MANDELBROT] = { 0 };
+	int fields[2] = { cache->block_size, cache->disk_slots };
+	memcpy(header, CACHE_MAGIC_MANDELBROT, 8);
+	memcpy(header + 8, fields, sizeof(fields));
+
+	//a file made for another block size or slot count is started again
+	struct stat info;
+	unsigned char old_header[CACHE_HEADER_SIZE_MANDELBROT];
+	int reuse = fstat(cache->fd, &info) == 0 && (size_t)info.st_size == cache->map_size
+		&& pread(cache->fd, old_header, sizeof(old_header), 0) == sizeof(old_header)
+		&& !memcmp(old_header, header, sizeof(header));
+	if (!reuse) {
+		if (ftruncate(cache->fd, 0) != 0 || ftruncate(cache->fd, cache->map_size) != 0
+			|| pwrite(cache->fd, header, sizeof(header), 0) != sizeof(header)) {
+			perror("cache file");
+			exit(EXIT_FAILURE);
+		}
+	}
+	cache->map = (unsigned char*)mmap(NULL, cache->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+	if (cache->map == MAP_FAILED) {
+		perror("mmap");
+		exit(EXIT_FAILURE);
+	}
+}
+
+t_tile_cache* open_cache_Mandelbrot(int capacity, const char* filename, int disk_slots, int block) {
+	t_tile_cache* cache = (t_tile_cache*)calloc(1, sizeof(t_tile_cache));
+	if (cache == NULL) {
+		perror("Memory allocation failed (cache)");
+		exit(EXIT_FAILURE);
+	}
+	cache->block_size = block;
+	cache->capacity = capacity;
+	cache->head = cache->tail = -1;
+	cache->fd = -1;
+	if (capacity > 0) {
+		cache->bucket_count = 2 * capacity;
+		cache->keys = (t_tile_cache_key*)malloc(sizeof(t_tile_cache_key) * capacity);
+		cache->data = (int*)malloc(sizeof(int) * (size_t)capacity * block * block);
+		cache->prev = (int*)malloc(sizeof(int) * capacity);
+		cache->next = (int*)malloc(sizeof(int) * capacity);
+		cache->chain = (int*)malloc(sizeof(int) * capacity);
+		cache->buckets = (int*)malloc(sizeof(int) * cache->bucket_count);
+		if (cache->keys == NULL || cache->data == NULL || cache->prev == NULL || cache->next == NULL
+			|| cache->chain == NULL || cache->buckets == NULL) {
+			perror("Memory allocation failed (cache)");
+			exit(EXIT_FAILURE);
+		}
+		for (int i = 0; i < cache->bucket_count; i++)
+			cache->buckets[i] = -1;
+	}
+	if (filename != NULL && disk_slots > 0) {
+		cache->disk_slots = disk_slots;
+		open_disk_level(cache, filename);
+	}
+	return cache;
+}
+
+static void unlink_entry(t_tile_cache* cache, int entry) {
+	if (cache->prev[entry] >= 0) cache->next[cache->prev[entry]] = cache->next[entry];
+	else cache->head = cache->next[entry];
+	if (cache->next[entry] >= 0) cache->prev[cache->next[entry]] = cache->prev[entry];
+	else cache->tail = cache->prev[entry];
+}
+
+static void push_front(t_tile_cache* cache, int entry) {
+	cache->prev[entry] = -1;
+	cache->next[entry] = cache->head;
+	if (cache->head >= 0) cache->prev[cache->head] = entry;
+	cache->head = entry;
+	if (cache->tail < 0) cache->tail = entry;
+}
+
+static int find_entry(t_tile_cache* cache, const t_tile_cache_key* key, unsigned long long hash) {
+	for (int entry = cache->buckets[hash % cache->bucket_count]; entry >= 0; entry = cache->chain[entry]) {
+		if (!memcmp(&cache->keys[entry], key, sizeof(t_tile_cache_key)))
+			return entry;
+	}
+	return -1;
+}
+
+static void remove_from_bucket(t_tile_cache* cache, int entry) {
+	int* link = &cache->buckets[hash_key(&cache->keys[entry]) % cache->bucket_count];
+	while (*link != entry)
+		link = &cache->chain[*link];
+	*link = cache->chain[entry];
+}
+
+static void store_memory(t_tile_cache* cache, const t_tile_cache_key* key, unsigned long long hash, const int* tile) {
+	size_t pixels = (size_t)cache->block_size * cache->block_size;
+	int entry = find_entry(cache, key, hash);
+	if (entry >= 0) {
+		unlink_entry(cache, entry);
+	}
+	else {
+		if (cache->used < cache->capacity) {
+			entry = cache->used++;
+		}
+		else {
+			//evict the least recently used tile
+			entry = cache->tail;
+			unlink_entry(cache, entry);
+			remove_from_bucket(cache, entry);
+		}
+		cache->keys[entry] = *key;
+		int bucket = hash % cache->bucket_count;
+		cache->chain[entry] = cache->buckets[bucket];
+		cache->buckets[bucket] = entry;
+	}
+	memcpy(cache->data + entry * pixels, tile, sizeof(int) * pixels);
+	push_front(cache, entry);
+}
+
+const int* lookup_cache_Mandelbrot(t_tile_cache* cache, const t_tile_cache_key* key) {
+	unsigned long long hash = hash_key(key);
+	size_t pixels = (size_t)cache->block_size * cache->block_size;
+	if (cache->capacity > 0) {
+		int entry = find_entry(cache, key, hash);
+		if (entry >= 0) {
+			unlink_entry(cache, entry);
+			push_front(cache, entry);
+			cache->memory_hits++;
+			return cache->data + entry * pixels;
+		}
+	}
+	if (cache->map != NULL) {
+		unsigned char* slot = disk_slot(cache, hash);
+		if (!memcmp(slot, key, sizeof(t_tile_cache_key))) {
+			const int* tile = (const int*)(slot + sizeof(t_tile_cache_key));
+			cache->disk_hits++;
+			if (cache->capacity > 0) {
+				store_memory(cache, key, hash, tile);
+				return cache->data + cache->head * pixels;
+			}
+			return tile;
+		}
+	}
+	cache->misses++;
+	return NULL;
+}
+
+void store_cache_Mandelbrot(t_tile_cache* cache, const t_tile_cache_key* key, const int* tile) {
+	//write through, new tiles go to both levels
+	unsigned long long hash = hash_key(key);
+	if (cache->capacity > 0)
+		store_memory(cache, key, hash, tile);
+	if (cache->map != NULL) {
+		unsigned char* slot = disk_slot(cache, hash);
+		memcpy(slot + sizeof(t_tile_cache_key), tile, sizeof(int) * cache->block_size * cache->block_size);
+		memcpy(slot, key, sizeof(t_tile_cache_key));
+	}
+}
+
+void close_cache_Mandelbrot(t_tile_cache* cache) {
+	if (cache->map != NULL) {
+		if (munmap(cache->map, cache->map_size) != 0)
+			perror("munmap");
+		close(cache->fd);
+	}
+	free(cache->keys);
+	free(cache->data);
+	free(cache->prev);
+	free(cache->next);
+	free(cache->chain);
+	free(cache->buckets);
+	free(cache);
+}
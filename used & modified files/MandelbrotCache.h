@@ -0,0 +1,57 @@
+#ifndef MANDELBROTCACHE_H
+#define MANDELBROTCACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//Tile cache of the Mandelbrot renders: in-memory LRU level and an optional mmap'd file level.
+//File: 64 byte header (magic, block size, slot count) followed by direct-mapped slots,
+//every slot is a key and block_size x block_size iteration counts.
+#define CACHE_MAGIC_MANDELBROT "MBCACHE2"
+#define CACHE_HEADER_SIZE_MANDELBROT 64
+
+typedef struct {
+	long long origin_re; // tile origin in 1/1024 pixel units, the same for panned views on the same pixel grid
+	long long origin_im;
+	double spacing_re; // pixel spacing
+	double spacing_im;
+	int max_iterations;
+	int kernel; // kernel version and precision
+	int width; // pixels of the tile inside the image
+	int height;
+	int fractal; // fractal and its parameters
+	int degree;
+	double julia_re;
+	double julia_im;
+} t_tile_cache_key;
+
+typedef struct {
+	int block_size;
+	//memory level
+	int capacity;
+	int used;
+	t_tile_cache_key* keys;
+	int* data; // capacity tiles of block_size x block_size
+	int* prev; // LRU list, head - most recently used
+	int* next;
+	int head, tail;
+	int* buckets; // hash table of the memory level
+	int* chain;
+	int bucket_count;
+	//file level
+	int fd;
+	unsigned char* map;
+	size_t map_size;
+	int disk_slots;
+	//statistics
+	long long memory_hits;
+	long long disk_hits;
+	long long misses;
+} t_tile_cache;
+
+t_tile_cache* open_cache_Mandelbrot(int capacity, const char* filename, int disk_slots, int block);
+const int* lookup_cache_Mandelbrot(t_tile_cache* cache, const t_tile_cache_key* key);
+void store_cache_Mandelbrot(t_tile_cache* cache, const t_tile_cache_key* key, const int* tile);
+void close_cache_Mandelbrot(t_tile_cache* cache);
+
+#endif
@@ -0,0 +1,114 @@
+#include "MandelbrotImage.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+unsigned char* build_palette_Mandelbrot(int iterations) {
+	//RGB triple for every possible iteration count, the colouring is the same as in the original writer
+	unsigned char* palette = (unsigned char*)malloc(3 * (size_t)(iterations + 1));
+	if (palette == NULL) {
+		perror("Memory allocation failed (palette)");
+		exit(EXIT_FAILURE);
+	}
+	for (int iter = 0; iter <= iterations; iter++) {
+		int val = log(iter + 1) / log(iterations + 1) * 255;
+		palette[3 * iter] = (unsigned char)(val % 256);
+		palette[3 * iter + 1] = (unsigned char)((val * 5) % 256);
+		palette[3 * iter + 2] = (unsigned char)((val * 13) % 256);
+	}
+	return palette;
+}
+
+int** allocate_image_Mandelbrot(int width, int height, int threadnum) {
+	int** image = (int**)malloc(height * sizeof(int*));
+	if (image == NULL) {
+		perror("Memory allocation failed (image_height)");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < height; ++i) {
+		image[i] = (int*)malloc(width * sizeof(int));
+		if (image[i] == NULL) {
+			perror("Memory allocation failed (image_width)");
+			exit(EXIT_FAILURE);
+		}
+	}
+	//the pages are zeroed, and so placed, by the threads of the kernel instead of by calloc on one thread
+	#pragma omp parallel for schedule(static) num_threads(threadnum)
+	for (int i = 0; i < height; ++i)
+		memset(image[i], 0, width * sizeof(int));
+	return image;
+}
+
+int save_image_Mandelbrot(const char* filename, int** result_buffer, int format, int threadnum) {
+	char header[64];
+	int header_length;
+	size_t pixel_size;
+
+	switch (format) {
+		case 0:
+			header_length = sprintf(header, "P6\n%d %d\n255\n", image_width, image_height);
+			pixel_size = 3;
+			break;
+		case 1:
+			header_length = sprintf(header, "P5\n%d %d\n65535\n", image_width, image_height);
+			pixel_size = 2;
+			break;
+		default:
+			printf("Bad image format\n");
+			return -1;
+	}
+	size_t row_size = pixel_size * image_width;
+	size_t file_size = header_length + row_size * image_height;
+
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror("open");
+		return -1;
+	}
+	if (ftruncate(fd, file_size) != 0) {
+		perror("ftruncate");
+		close(fd);
+		return -1;
+	}
+	//Every thread writes its rows straight into the page cache, no stdio buffering
+	unsigned char* image = (unsigned char*)mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (image == MAP_FAILED) {
+		perror("mmap");
+		close(fd);
+		return -1;
+	}
+	memcpy(image, header, header_length);
+
+	unsigned char* palette = format == 0 ? build_palette_Mandelbrot(max_iterations) : NULL;
+
+	#pragma omp parallel for schedule(static) num_threads(threadnum)
+	for (int y = 0; y < image_height; y++) {
+		unsigned char* row = image + header_length + row_size * y;
+		int* iterations = result_buffer[y];
+		if (format == 0) {
+			for (int x = 0; x < image_width; x++) {
+				int iter = iterations[x];
+				if (iter > max_iterations) iter = max_iterations;
+				memcpy(row + 3 * x, palette + 3 * iter, 3);
+			}
+		}
+		else {
+			//PGM stores 16-bit samples big endian
+			for (int x = 0; x < image_width; x++) {
+				int iter = iterations[x] < 65535 ? iterations[x] : 65535;
+				row[2 * x] = (unsigned char)(iter >> 8);
+				row[2 * x + 1] = (unsigned char)(iter & 0xFF);
+			}
+		}
+	}
+
+	free(palette);
+	if (munmap(image, file_size) != 0) {
+		perror("munmap");
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef MANDELBROTIMAGE_H
+#define MANDELBROTIMAGE_H
+#include "Mandelbrot.h"
+
+//Output formats
+// 0 - PPM (P6), iterations colourised through a lookup table
+// 1 - PGM (P5) with 16-bit samples holding the raw iteration count (clamped to 65535)
+
+unsigned char* build_palette_Mandelbrot(int iterations);
+//zeroed result buffer of height rows, the rows are touched first by threadnum threads
+int** allocate_image_Mandelbrot(int width, int height, int threadnum);
+int save_image_Mandelbrot(const char* filename, int** result_buffer, int format, int threadnum);
+
+#endif
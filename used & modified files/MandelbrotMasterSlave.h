@@ -1,25 +1,47 @@
-#ifndef MANDELBROTMasterSlave_H
-#define MANDELBROTMasterSlave_H
-#include "Mandelbrot.h"
-
-typedef struct {
-	double re_min;
-	double re_max;
-	double im_min;
-	double im_max;
-	int image_width;
-	int image_height;
-	int max_iterations;
-	int block_size;
-	int thread_num;
-	int model; // 0 - dynamic, 1 - tasking, 2 - integrated
-	int buffer_size; // size of the buffer for dynamic model
-}SettingsMandelbrot;
-
-void dynamicForMandelbrot(int** result_buffer, SettingsMandelbrot settings);
-void taskingMandelbrot(int** result_buffer, SettingsMandelbrot settings);
-void integratedMasterMandelbrot(int** result_buffer, SettingsMandelbrot settings);
-void save_result_as_ppm(const char* filename, int** result_buffer);
-void print_progress(int percent);
-
+#ifndef MANDELBROTMasterSlave_H
+#define MANDELBROTMasterSlave_H
+#include "Mandelbrot.h"
+#include "Affinity.h"
+
+typedef struct {
+	double re_min;
+	double re_max;
+	double im_min;
+	double im_max;
+	int image_width;
+	int image_height;
+	int max_iterations;
+	int block_size;
+	int thread_num;
+	int model; // 0 - dynamic, 1 - tasking, 2 - integrated
+	int buffer_size; // size of the buffer for dynamic model
+	int order; // 0 - column, 1 - heaviest first (LPT), 2 - Morton, 3 - Hilbert
+	int preview_iterations; // iterations of the preview pass used by the LPT order
+	const char* output; // image file to write, NULL - no output
+	int format; // 0 - PPM, 1 - 16-bit PGM with raw iterations
+	const char* stream; // tiled output file of the streaming mode, NULL - render into memory
+	int inflight; // tiles in flight between the workers and the writer in streaming mode
+	int deep; // 1 - perturbation kernel for zooms beyond double precision
+	int precision; // 0 - auto from the pixel spacing, 1 - float, 2 - double
+	int validate; // compare every n-th pixel with the double kernel, 0 - off
+	int report; // 1 - print working time and energy
+	int cache; // tiles kept by the in-memory tile cache, 0 - no cache
+	const char* cachefile; // file of the persistent tile cache, NULL - memory only
+	int cacheslots; // tile slots of the cache file
+	int symmetry; // 1 - copy the rows mirrored about the real axis instead of computing them
+	int fractal; // 0 - Mandelbrot, 1 - Julia, 2 - Burning Ship, 3 - Multibrot
+	double julia_re; // c of the Julia set
+	double julia_im;
+	int degree; // d of the Multibrot set
+	int progressive; // 1 - render and publish 1/16, 1/4 and then all pixels
+	int frames; // number of frames of the animation mode, 0 - single image
+	const char* path; // keyframe file of the animation mode
+	int affinity; // 1 - owner-computes queues in the dynamic model, a tile column stays with one thread
+}SettingsMandelbrot;
+
+void dynamicForMandelbrot(int** result_buffer, SettingsMandelbrot settings);
+void taskingMandelbrot(int** result_buffer, SettingsMandelbrot settings);
+void integratedMasterMandelbrot(int** result_buffer, SettingsMandelbrot settings);
+void print_progress(int percent);
+
 #endif
\ No newline at end of file
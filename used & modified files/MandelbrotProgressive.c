@@ -0,0 +1,137 @@
+#include "MandelbrotProgressive.h"
+#include "Mandelbrot.h"
+#include "MandelbrotImage.h"
+#include <string.h>
+
+static int publish_level(t_progressive* progressive, int level, int threadnum) {
+	int error = 0;
+	if (progressive->filename != NULL) {
+		char name[4096];
+		const char* filename = progressive->filename;
+		if (strchr(filename, '%') != NULL) {
+			snprintf(name, sizeof(name), filename, level);
+			filename = name;
+		}
+		int step = 1 << (progressive->levels - 1 - level);
+		int** image = progressive->result_buffer;
+		if (step > 1) {
+			fill_level_Mandelbrot(progressive->result_buffer, progressive->preview, step);
+			image = progressive->preview;
+		}
+		error = save_image_Mandelbrot(filename, image, progressive->format, threadnum) != 0;
+	}
+	progressive->level_time[level] = omp_get_wtime() - progressive->start_time;
+	return error;
+}
+
+static void* writer_thread(void* arg) {
+	t_progressive* progressive = (t_progressive*)arg;
+
+	//the last level is published by close_progressive_Mandelbrot after the mirrored rows are copied
+	pthread_mutex_lock(&progressive->lock);
+	while (progressive->published < progressive->levels - 1) {
+		while (!(progressive->started && progressive->remaining[progressive->published] == 0) && !progressive->done)
+			pthread_cond_wait(&progressive->level_ready, &progressive->lock);
+		if (!(progressive->started && progressive->remaining[progressive->published] == 0))
+			break;
+		int level = progressive->published;
+		pthread_mutex_unlock(&progressive->lock);
+
+		//one thread, the workers are still busy with the finer levels
+		int failed = publish_level(progressive, level, 1);
+
+		pthread_mutex_lock(&progressive->lock);
+		progressive->error |= failed;
+		progressive->published++;
+	}
+	pthread_mutex_unlock(&progressive->lock);
+	return NULL;
+}
+
+t_progressive* open_progressive_Mandelbrot(const char* filename, int format, int width, int height, int** result_buffer) {
+	t_progressive* progressive = (t_progressive*)calloc(1, sizeof(t_progressive));
+	if (progressive == NULL) {
+		perror("Memory allocation failed (progressive)");
+		exit(EXIT_FAILURE);
+	}
+	progressive->filename = filename;
+	progressive->format = format;
+	progressive->levels = PROGRESSIVE_LEVELS_MANDELBROT;
+	progressive->result_buffer = result_buffer;
+	progressive->width = width;
+	progressive->height = height;
+	progressive->remaining = (int*)calloc(progressive->levels, sizeof(int));
+	progressive->level_time = (double*)calloc(progressive->levels, sizeof(double));
+	if (progressive->remaining == NULL || progressive->level_time == NULL) {
+		perror("Memory allocation failed (progressive)");
+		exit(EXIT_FAILURE);
+	}
+	if (filename != NULL) {
+		progressive->preview = (int**)malloc(sizeof(int*) * height);
+		if (progressive->preview == NULL) {
+			perror("Memory allocation failed (preview)");
+			exit(EXIT_FAILURE);
+		}
+		for (int i = 0; i < height; i++) {
+			progressive->preview[i] = (int*)malloc(sizeof(int) * width);
+			if (progressive->preview[i] == NULL) {
+				perror("Memory allocation failed (preview)");
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	progressive->start_time = omp_get_wtime();
+	pthread_mutex_init(&progressive->lock, NULL);
+	pthread_cond_init(&progressive->level_ready, NULL);
+	if (pthread_create(&progressive->writer, NULL, writer_thread, progressive) != 0) {
+		perror("pthread_create");
+		exit(EXIT_FAILURE);
+	}
+	return progressive;
+}
+
+void start_levels_Mandelbrot(t_progressive* progressive, int tiles_per_level) {
+	pthread_mutex_lock(&progressive->lock);
+	for (int level = 0; level < progressive->levels; level++)
+		progressive->remaining[level] = tiles_per_level;
+	progressive->started = 1;
+	pthread_cond_signal(&progressive->level_ready);
+	pthread_mutex_unlock(&progressive->lock);
+}
+
+void tile_level_done_Mandelbrot(t_progressive* progressive, int level) {
+	pthread_mutex_lock(&progressive->lock);
+	if (--progressive->remaining[level] == 0)
+		pthread_cond_signal(&progressive->level_ready);
+	pthread_mutex_unlock(&progressive->lock);
+}
+
+int close_progressive_Mandelbrot(t_progressive* progressive, int threadnum) {
+	pthread_mutex_lock(&progressive->lock);
+	progressive->done = 1;
+	pthread_cond_signal(&progressive->level_ready);
+	pthread_mutex_unlock(&progressive->lock);
+	pthread_join(progressive->writer, NULL);
+
+	//full resolution level, all threads are free now
+	int error = progressive->error;
+	if (progressive->published == progressive->levels - 1) {
+		error |= publish_level(progressive, progressive->levels - 1, threadnum);
+		progressive->published++;
+	}
+	return error ? -1 : 0;
+}
+
+void free_progressive_Mandelbrot(t_progressive* progressive) {
+	pthread_mutex_destroy(&progressive->lock);
+	pthread_cond_destroy(&progressive->level_ready);
+	if (progressive->preview != NULL) {
+		for (int i = 0; i < progressive->height; i++)
+			free(progressive->preview[i]);
+		free(progressive->preview);
+	}
+	free(progressive->remaining);
+	free(progressive->level_time);
+	free(progressive);
+}
@@ -0,0 +1,39 @@
+#ifndef MANDELBROTPROGRESSIVE_H
+#define MANDELBROTPROGRESSIVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+//Progressive rendering: every tile is computed in levels, level l computes every step-th pixel
+//of every step-th row, step = 1 << (levels - 1 - l), pixels of the coarser levels are not computed again.
+//A level is published as soon as all of its tiles and all coarser levels are finished,
+//missing pixels are filled with the nearest computed pixel above and to the left.
+#define PROGRESSIVE_LEVELS_MANDELBROT 3 // steps 4, 2, 1 - 1/16, 1/4 and all pixels
+
+typedef struct {
+	const char* filename; // image of every level, may contain %d for the level number, NULL - no output
+	int format;
+	int levels;
+	int** result_buffer;
+	int** preview; // image of the level being published
+	int width, height;
+	int* remaining; // tiles of every level still in the works
+	int started; // remaining is set by start_levels_Mandelbrot
+	int published; // levels published so far
+	int done;
+	int error;
+	double start_time;
+	double* level_time; // seconds from the start to the publishing of every level
+	pthread_mutex_t lock;
+	pthread_cond_t level_ready;
+	pthread_t writer;
+} t_progressive;
+
+t_progressive* open_progressive_Mandelbrot(const char* filename, int format, int width, int height, int** result_buffer);
+void start_levels_Mandelbrot(t_progressive* progressive, int tiles_per_level);
+void tile_level_done_Mandelbrot(t_progressive* progressive, int level);
+int close_progressive_Mandelbrot(t_progressive* progressive, int threadnum);
+void free_progressive_Mandelbrot(t_progressive* progressive);
+
+#endif
@@ -0,0 +1,145 @@
+#include "MandelbrotStream.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static void* writer_thread(void* arg) {
+	t_tile_stream* stream = (t_tile_stream*)arg;
+	int pixels = stream->block_size * stream->block_size;
+	unsigned short* tile_data = (unsigned short*)malloc(stream->tile_bytes);
+	if (tile_data == NULL) {
+		perror("Memory allocation failed (writer)");
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_mutex_lock(&stream->lock);
+	for (;;) {
+		while (stream->queued == 0 && !stream->done)
+			pthread_cond_wait(&stream->tile_ready, &stream->lock);
+		if (stream->queued == 0)
+			break;
+		int slot = stream->queue_slot[stream->head];
+		int tile = stream->queue_tile[stream->head];
+		stream->head = (stream->head + 1) % stream->slot_count;
+		stream->queued--;
+		pthread_mutex_unlock(&stream->lock);
+
+		//convert to 16-bit and write the tile at its place in the file
+		int* iterations = stream->slots + (size_t)slot * pixels;
+		for (int i = 0; i < pixels; i++)
+			tile_data[i] = iterations[i] < 65535 ? (unsigned short)iterations[i] : 65535;
+		off_t offset = STREAM_HEADER_SIZE_MANDELBROT + (off_t)tile * stream->tile_bytes;
+		int failed = pwrite(stream->fd, tile_data, stream->tile_bytes, offset) != (ssize_t)stream->tile_bytes;
+		if (failed)
+			perror("pwrite");
+
+		pthread_mutex_lock(&stream->lock);
+		stream->error |= failed;
+		stream->written++;
+		stream->free_slots[stream->free_count++] = slot;
+		pthread_cond_signal(&stream->slot_free);
+	}
+	pthread_mutex_unlock(&stream->lock);
+	free(tile_data);
+	return NULL;
+}
+
+t_tile_stream* open_stream_Mandelbrot(const char* filename, int width, int height, int block, int iterations, int slot_count) {
+	if (slot_count < 1) {
+		printf("At least one tile has to be in flight\n");
+		return NULL;
+	}
+	t_tile_stream* stream = (t_tile_stream*)calloc(1, sizeof(t_tile_stream));
+	if (stream == NULL) {
+		perror("Memory allocation failed (stream)");
+		exit(EXIT_FAILURE);
+	}
+	int tiles_w = (width + block - 1) / block;
+	int tiles_h = (height + block - 1) / block;
+	stream->block_size = block;
+	stream->tile_bytes = sizeof(unsigned short) * block * block;
+	stream->slot_count = slot_count;
+
+	stream->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (stream->fd < 0) {
+		perror("open");
+		free(stream);
+		return NULL;
+	}
+	unsigned char header[STREAM_HEADER_SIZE_MANDELBROT] = { 0 };
+	int fields[6] = { width, height, block, tiles_w, tiles_h, iterations };
+	memcpy(header, STREAM_MAGIC_MANDELBROT, 8);
+	memcpy(header + 8, fields, sizeof(fields));
+	//file gets its final size up front, tiles arrive in any order
+	off_t file_size = STREAM_HEADER_SIZE_MANDELBROT + (off_t)tiles_w * tiles_h * stream->tile_bytes;
+	if (pwrite(stream->fd, header, sizeof(header), 0) != sizeof(header) || ftruncate(stream->fd, file_size) != 0) {
+		perror("stream header");
+		close(stream->fd);
+		free(stream);
+		return NULL;
+	}
+
+	stream->slots = (int*)malloc(sizeof(int) * (size_t)slot_count * block * block);
+	stream->free_slots = (int*)malloc(sizeof(int) * slot_count);
+	stream->queue_slot = (int*)malloc(sizeof(int) * slot_count);
+	stream->queue_tile = (int*)malloc(sizeof(int) * slot_count);
+	if (stream->slots == NULL || stream->free_slots == NULL || stream->queue_slot == NULL || stream->queue_tile == NULL) {
+		perror("Memory allocation failed (stream slots)");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < slot_count; i++)
+		stream->free_slots[i] = i;
+	stream->free_count = slot_count;
+
+	pthread_mutex_init(&stream->lock, NULL);
+	pthread_cond_init(&stream->slot_free, NULL);
+	pthread_cond_init(&stream->tile_ready, NULL);
+	if (pthread_create(&stream->writer, NULL, writer_thread, stream) != 0) {
+		perror("pthread_create");
+		exit(EXIT_FAILURE);
+	}
+	return stream;
+}
+
+int* acquire_tile_Mandelbrot(t_tile_stream* stream, int* slot) {
+	//blocks while all slots are in flight, this is the backpressure on the workers and the generator
+	pthread_mutex_lock(&stream->lock);
+	while (stream->free_count == 0)
+		pthread_cond_wait(&stream->slot_free, &stream->lock);
+	*slot = stream->free_slots[--stream->free_count];
+	pthread_mutex_unlock(&stream->lock);
+	return stream->slots + (size_t)(*slot) * stream->block_size * stream->block_size;
+}
+
+void submit_tile_Mandelbrot(t_tile_stream* stream, int slot, int tile) {
+	pthread_mutex_lock(&stream->lock);
+	int tail = (stream->head + stream->queued) % stream->slot_count;
+	stream->queue_slot[tail] = slot;
+	stream->queue_tile[tail] = tile;
+	stream->queued++;
+	pthread_cond_signal(&stream->tile_ready);
+	pthread_mutex_unlock(&stream->lock);
+}
+
+int close_stream_Mandelbrot(t_tile_stream* stream) {
+	pthread_mutex_lock(&stream->lock);
+	stream->done = 1;
+	pthread_cond_signal(&stream->tile_ready);
+	pthread_mutex_unlock(&stream->lock);
+	pthread_join(stream->writer, NULL);
+
+	int error = stream->error;
+	if (close(stream->fd) != 0) {
+		perror("close");
+		error = 1;
+	}
+	pthread_mutex_destroy(&stream->lock);
+	pthread_cond_destroy(&stream->slot_free);
+	pthread_cond_destroy(&stream->tile_ready);
+	free(stream->slots);
+	free(stream->free_slots);
+	free(stream->queue_slot);
+	free(stream->queue_tile);
+	free(stream);
+	return error ? -1 : 0;
+}
@@ -0,0 +1,39 @@
+#ifndef MANDELBROTSTREAM_H
+#define MANDELBROTSTREAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+//Tiled output file: 64 byte header followed by every tile as block_size x block_size
+//16-bit iteration counts (row major, partial edge tiles are padded with zeros).
+//Tiles are stored by tile index (block_x * tiles_y + block_y) no matter in which order they were computed.
+#define STREAM_MAGIC_MANDELBROT "MBTILES1"
+#define STREAM_HEADER_SIZE_MANDELBROT 64
+
+typedef struct {
+	int fd;
+	int block_size;
+	size_t tile_bytes; // bytes of one tile in the file
+	int slot_count; // number of tiles that can be in flight (computed or waiting for the writer)
+	int* slots; // slot_count tile buffers, block_size * block_size iterations each
+	int* free_slots; // stack of free slot ids
+	int free_count;
+	int* queue_slot; // ring of slots waiting for the writer
+	int* queue_tile; // tile index of every queued slot
+	int head, queued;
+	int done;
+	int error;
+	long long written;
+	pthread_mutex_t lock;
+	pthread_cond_t slot_free;
+	pthread_cond_t tile_ready;
+	pthread_t writer;
+} t_tile_stream;
+
+t_tile_stream* open_stream_Mandelbrot(const char* filename, int width, int height, int block, int iterations, int slot_count);
+int* acquire_tile_Mandelbrot(t_tile_stream* stream, int* slot);
+void submit_tile_Mandelbrot(t_tile_stream* stream, int slot, int tile);
+int close_stream_Mandelbrot(t_tile_stream* stream);
+
+#endif
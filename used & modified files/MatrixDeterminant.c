@@ -1,96 +1,1241 @@
-#include "MatrixDeterminant.h"
-
-int BUFFERSIZEMATRIX;
-int CHUNKCOUNTMATRIX;
-int MATRIXSIZE;
-
-long generate_new_input_Matrix(t_input_matrix* input, double** matrix) { // returned value: how many items generated
-
-    static int howmanygenerated = 0;
-    static int x = 0, y = 1;
-
-    int max = BUFFERSIZEMATRIX;
-    if (BUFFERSIZEMATRIX > (CHUNKCOUNTMATRIX - howmanygenerated))
-        max = CHUNKCOUNTMATRIX - howmanygenerated;
-
-	//Generate which matrix[x][y] to process
-    //Gaussian elimination
-    int counter = 0;
-    for (counter = 0;counter < max;counter++) {
-		input[counter].pivot_row_index = x;
-		input[counter].target_row_index = y++;
-		howmanygenerated++;
-        if (y == MATRIXSIZE) {
-            x++;
-			y = x + 1;
-			if (x == MATRIXSIZE) {
-				break;
-			}
-        }
-    }
-    return counter;
-}
-
-void process_Matrix(t_input_matrix* data, double** matrix) {
-
-	int pivot_row_index = data->pivot_row_index;
-	int target_row_index = data->target_row_index;
-	
-	double factor = matrix[target_row_index][pivot_row_index] / matrix[pivot_row_index][pivot_row_index];
-
-	for (int i = 0; i < MATRIXSIZE; i++) {
-		matrix[target_row_index][i] -= factor * matrix[pivot_row_index][i];
-	}
-	return;
-}
-
-long double determinant(double** matrix) {
-    long double det = 1.0;
-	for (int i = 0; i < MATRIXSIZE; i++) {
-		det *= matrix[i][i];
-	}
-	return det;
-}
-
-double** generateVandermondeMatrix(int size) {
-    double** matrix = (double**)malloc(size * sizeof(double*));
-    if (matrix == NULL) {
-        perror("Memory allocation failed (rows)");
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < size; i++) {
-        matrix[i] = (double*)malloc(size * sizeof(double));
-        if (matrix[i] == NULL) {
-            perror("Memory allocation failed (columns)");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    for (int i = 0; i < size; i++) {
-        double base = (double)(i + 1);  // x_i
-        for (int j = 0; j < size; j++) {
-            matrix[i][j] = pow(base, j);  // x_i^j
-        }
-    }
-
-    return matrix;
-}
-
-long double vandermondeDeterminant(int size) {
-	double* x = (double*)malloc(size * sizeof(double));
-    if (x == NULL) {
-        perror("Memory allocation failed");
-        exit(EXIT_FAILURE);
-    }
-	for (int i = 1; i <= size; i++) {
-		x[i - 1] = (double)i;
-	}
-    long double det = 1.0;
-    for (int i = 0; i < size - 1; i++) {
-        for (int j = i + 1; j < size; j++) {
-            det *= (x[j] - x[i]);
-        }
-    }
-    return det;
+#include "MatrixDeterminant.h"
+#include "MatrixExact.h"
+#include <immintrin.h>
+#include <sys/mman.h>
+
+int BUFFERSIZEMATRIX;
+int CHUNKCOUNTMATRIX;
+int MATRIXSIZE;
+int MATRIXENGINE;
+int MATRIXBLOCK;
+int MATRIXPIVOT;
+const char* matrix_kernel = "generic";
+
+static int howmanygenerated = 0;
+//state of the generator: step (pivot row, first row of the diagonal block or phase of the recursive
+//schedule), phase of the step and packet within the phase
+static int current_step = 0, current_phase = 0, current_index = 0;
+
+//Phase of the recursive LU, columns c0 .. m - 1 are the left half and m .. c1 - 1 the right half
+typedef struct {
+    int kind; // PANEL (leaf c0 .. c1), U12 (right half), GEMM (right half below m), LEFT (left half)
+    int c0, m, c1;
+    int rows, cols; // packet grid of the phase
+} t_phase_matrix;
+
+static t_phase_matrix* schedule = NULL;
+static int schedule_length = 0, schedule_capacity = 0;
+
+static long batch_groups = 0; //lane groups of the batched mode, 0 - one matrix
+static int batch_packets = 0;
+static int solve_tiles = 0, solve_columns = 0; //column tiles of the right-hand sides, 0 - factorisation
+
+static int row_by_row(void) {
+    //the Bareiss engine eliminates row by row as well, on the exact copy of the matrix
+    return MATRIXENGINE == 0 || MATRIXENGINE == 3;
+}
+
+static int block_count(int from) {
+    return (MATRIXSIZE - from + MATRIXBLOCK - 1) / MATRIXBLOCK;
+}
+
+static int search_count(int step) {
+    return (MATRIXSIZE - step + PIVOT_ROWS_MATRIX - 1) / PIVOT_ROWS_MATRIX;
+}
+
+static int last_step(void) {
+    //the blocked LU ends with a step that only applies the interchanges to the L columns
+    if (batch_groups > 0)
+        return 0;
+    if (solve_tiles > 0) //interchanges, forward substitution block by block, back substitution
+        return 2 * block_count(0);
+    switch (MATRIXENGINE) {
+        case 0:
+        case 3: return MATRIXSIZE - 2;
+        case 1: return block_count(0) * MATRIXBLOCK;
+        default: return schedule_length - 1;
+    }
+}
+
+static int next_step(int step) {
+    return MATRIXENGINE == 1 && solve_tiles == 0 ? step + MATRIXBLOCK : step + 1;
+}
+
+static int phase_size(int step, int phase) {
+    if (batch_groups > 0) //independent matrices, one phase
+        return phase == 0 ? batch_packets : 0;
+    if (solve_tiles > 0) {
+        //0 - diagonal block of every column tile, 1 - the blocks below (forward) or above (back) it
+        int nt = block_count(0);
+        if (step == 0)
+            return phase == 0 ? solve_tiles : 0;
+        int rest = step <= nt ? nt - step : 2 * nt - step;
+        switch (phase) {
+            case 0: return solve_tiles;
+            case 1: return rest * solve_tiles;
+            default: return 0;
+        }
+    }
+    if (MATRIXENGINE == 2) //every phase of the schedule is a step of its own
+        return phase == 0 ? schedule[step].rows * schedule[step].cols : 0;
+    if (row_by_row()) {
+        //0 - pivot search, 1 - row interchange (and the divisor of the Bareiss engine, also without
+        //pivoting), 2 - elimination of the rows below the pivot
+        switch (phase) {
+            case 0: return MATRIXPIVOT ? search_count(step) : 0;
+            case 1: return MATRIXPIVOT || MATRIXENGINE == 3;
+            default: return MATRIXSIZE - step - 1;
+        }
+    }
+    if (step >= MATRIXSIZE)
+        return phase == 0 && MATRIXPIVOT ? block_count(0) - 1 : 0;
+    //0 - diagonal block (whole panel with pivoting), 1 - L21 row packets and U12 column packets
+    //(U12 only with pivoting, L21 is a part of the panel), 2 - trailing matrix tiles
+    int rest = block_count(step + MATRIXBLOCK < MATRIXSIZE ? step + MATRIXBLOCK : MATRIXSIZE);
+    switch (phase) {
+        case 0: return 1;
+        case 1: return MATRIXPIVOT ? rest : 2 * rest;
+        default: return rest * rest;
+    }
+}
+
+static void add_phase(int kind, int c0, int m, int c1, int rows, int cols) {
+    if (schedule_length == schedule_capacity) {
+        schedule_capacity = schedule_capacity ? 2 * schedule_capacity : 64;
+        schedule = (t_phase_matrix*)realloc(schedule, sizeof(t_phase_matrix) * schedule_capacity);
+        if (schedule == NULL) {
+            perror("Memory allocation failed (schedule)");
+            exit(EXIT_FAILURE);
+        }
+    }
+    t_phase_matrix* phase = &schedule[schedule_length++];
+    phase->kind = kind;
+    phase->c0 = c0;
+    phase->m = m;
+    phase->c1 = c1;
+    phase->rows = rows;
+    phase->cols = cols;
+}
+
+static int parts(int length, int part) {
+    return (length + part - 1) / part;
+}
+
+static int split_column(int c0, int c1, int part, int parts) {
+    //column boundaries are kept on cache lines (8 doubles), unaligned rows cost every vector load twice
+    if (part == parts)
+        return c1;
+    int column = c0 + (int)((long)(c1 - c0) * part / parts);
+    column = column / 8 * 8;
+    return column > c0 ? column : c0;
+}
+
+static void schedule_recursive(int c0, int c1) {
+    //LU of the columns c0 .. c1 - 1 (rows c0 .. MATRIXSIZE - 1): factor the left half, apply its
+    //interchanges to the right half and solve U12, update the right half below it, factor the
+    //right half, apply the interchanges of the right half to the L part of the left half
+    if (c1 - c0 <= RECURSIVE_LEAF_MATRIX) {
+        add_phase(PACKET_PANEL_MATRIX, c0, c1, c1, 1, 1);
+        return;
+    }
+    int m = split_column(c0, c1, 1, 2);
+    if (m == c0)
+        m = c0 + (c1 - c0) / 2;
+    schedule_recursive(c0, m);
+    add_phase(PACKET_U12_MATRIX, c0, m, c1, 1, parts(c1 - m, RECURSIVE_TILE_MATRIX));
+    add_phase(PACKET_GEMM_MATRIX, c0, m, c1, parts(MATRIXSIZE - m, RECURSIVE_TILE_MATRIX), parts(c1 - m, RECURSIVE_TILE_MATRIX));
+    schedule_recursive(m, c1);
+    if (MATRIXPIVOT)
+        add_phase(PACKET_LEFT_MATRIX, c0, m, c1, 1, parts(m - c0, RECURSIVE_TILE_MATRIX));
+}
+
+void prepare_Matrix(t_matrix* matrix, int engine, int block, int pivot, int threads) {
+    MATRIXENGINE = engine;
+    MATRIXBLOCK = block;
+    MATRIXPIVOT = pivot;
+    howmanygenerated = 0;
+    current_step = current_phase = current_index = 0;
+    schedule_length = 0;
+    batch_groups = matrix->batch != NULL ? matrix->batch->groups : 0;
+    batch_packets = (int)((batch_groups + BATCH_GROUPS_MATRIX - 1) / BATCH_GROUPS_MATRIX);
+    //with right-hand sides the matrix holds the factors already and only the solves are generated
+    solve_columns = matrix->rhs != NULL ? matrix->rhs->cols : 0;
+    solve_tiles = parts(solve_columns, SOLVE_COLUMNS_MATRIX);
+    if (batch_groups == 0 && solve_tiles == 0 && engine == 2 && MATRIXSIZE > 0)
+        schedule_recursive(0, MATRIXSIZE);
+    if (batch_groups == 0 && solve_tiles == 0 && engine == 3)
+        prepare_exact_Matrix(matrix, threads);
+    CHUNKCOUNTMATRIX = 0;
+    for (int step = 0; step <= last_step(); step = next_step(step))
+        CHUNKCOUNTMATRIX += phase_size(step, 0) + phase_size(step, 1) + phase_size(step, 2);
+}
+
+static void row_packet(t_input_matrix* packet, int step, int phase, int index) {
+    static const int kinds[3] = { PACKET_SEARCH_MATRIX, PACKET_SWAP_MATRIX, PACKET_ROW_MATRIX };
+    packet->kind = kinds[phase];
+    packet->step = step;
+    packet->pivot_row_index = step;
+    packet->target_row_index = step + 1 + index;
+    packet->begin = step + index * PIVOT_ROWS_MATRIX;
+    packet->end = packet->begin + PIVOT_ROWS_MATRIX < MATRIXSIZE ? packet->begin + PIVOT_ROWS_MATRIX : MATRIXSIZE;
+}
+
+static void blocked_packet(t_input_matrix* packet, int step, int phase, int index) {
+    int first = step + MATRIXBLOCK < MATRIXSIZE ? step + MATRIXBLOCK : MATRIXSIZE;
+    int rest = block_count(first);
+    packet->step = step;
+    packet->width = first - step;
+    if (step >= MATRIXSIZE) {
+        //block column index, the interchanges of all later steps are applied to its rows
+        packet->kind = PACKET_LEFT_MATRIX;
+        packet->begin = index * MATRIXBLOCK;
+        packet->end = packet->begin + MATRIXBLOCK;
+        packet->step = packet->end;
+        packet->width = MATRIXSIZE - packet->end;
+        return;
+    }
+    if (phase == 0) {
+        packet->kind = MATRIXPIVOT ? PACKET_PANEL_MATRIX : PACKET_DIAG_MATRIX;
+        return;
+    }
+    if (phase == 1) {
+        packet->kind = index < rest && !MATRIXPIVOT ? PACKET_L21_MATRIX : PACKET_U12_MATRIX;
+        index %= rest;
+    }
+    else {
+        packet->kind = PACKET_GEMM_MATRIX;
+        packet->col_begin = first + index % rest * MATRIXBLOCK;
+        packet->col_end = packet->col_begin + MATRIXBLOCK < MATRIXSIZE ? packet->col_begin + MATRIXBLOCK : MATRIXSIZE;
+        index /= rest;
+    }
+    packet->begin = first + index * MATRIXBLOCK;
+    packet->end = packet->begin + MATRIXBLOCK < MATRIXSIZE ? packet->begin + MATRIXBLOCK : MATRIXSIZE;
+}
+
+static void solve_packet(t_input_matrix* packet, int step, int phase, int index) {
+    int nt = block_count(0);
+    int tile = index % solve_tiles;
+    packet->col_begin = tile * SOLVE_COLUMNS_MATRIX;
+    packet->col_end = packet->col_begin + SOLVE_COLUMNS_MATRIX < solve_columns ? packet->col_begin + SOLVE_COLUMNS_MATRIX : solve_columns;
+    if (step == 0) {
+        packet->kind = PACKET_PERMUTE_MATRIX;
+        packet->step = packet->begin = 0;
+        packet->end = packet->width = MATRIXSIZE;
+        return;
+    }
+    int forward = step <= nt;
+    int k = forward ? step - 1 : 2 * nt - step;
+    packet->step = k * MATRIXBLOCK;
+    packet->width = packet->step + MATRIXBLOCK < MATRIXSIZE ? MATRIXBLOCK : MATRIXSIZE - packet->step;
+    int block = k;
+    if (phase == 0)
+        packet->kind = forward ? PACKET_LOWER_MATRIX : PACKET_UPPER_MATRIX;
+    else {
+        packet->kind = PACKET_RHS_MATRIX;
+        block = forward ? k + 1 + index / solve_tiles : index / solve_tiles;
+    }
+    packet->begin = block * MATRIXBLOCK;
+    packet->end = packet->begin + MATRIXBLOCK < MATRIXSIZE ? packet->begin + MATRIXBLOCK : MATRIXSIZE;
+}
+
+static void recursive_packet(t_input_matrix* packet, int step, int index) {
+    //packets of a phase split its rows and columns evenly into the grid of the phase
+    const t_phase_matrix* phase = &schedule[step];
+    int row = index / phase->cols, col = index % phase->cols;
+    packet->kind = phase->kind;
+    packet->step = phase->c0;
+    packet->width = phase->m - phase->c0;
+    switch (phase->kind) {
+        case PACKET_PANEL_MATRIX:
+            packet->width = phase->c1 - phase->c0;
+            break;
+        case PACKET_GEMM_MATRIX:
+            packet->begin = phase->m + (int)((long)(MATRIXSIZE - phase->m) * row / phase->rows);
+            packet->end = phase->m + (int)((long)(MATRIXSIZE - phase->m) * (row + 1) / phase->rows);
+            // fall through
+        case PACKET_U12_MATRIX:
+            packet->col_begin = split_column(phase->m, phase->c1, col, phase->cols);
+            packet->col_end = split_column(phase->m, phase->c1, col + 1, phase->cols);
+            if (phase->kind == PACKET_U12_MATRIX) {
+                packet->begin = packet->col_begin;
+                packet->end = packet->col_end;
+            }
+            break;
+        case PACKET_LEFT_MATRIX:
+            //interchanges of the right half on a part of the left half
+            packet->step = phase->m;
+            packet->width = phase->c1 - phase->m;
+            packet->begin = split_column(phase->c0, phase->m, col, phase->cols);
+            packet->end = split_column(phase->c0, phase->m, col + 1, phase->cols);
+            break;
+    }
+}
+
+long generate_new_input_Matrix(t_input_matrix* input, t_matrix* matrix) { // returned value: how many items generated
+
+
+    int max = BUFFERSIZEMATRIX;
+    if (BUFFERSIZEMATRIX > (CHUNKCOUNTMATRIX - howmanygenerated))
+        max = CHUNKCOUNTMATRIX - howmanygenerated;
+
+    //packets of one batch always come from one phase of one step, the models finish a batch before
+    //the next one is generated, so a phase never starts before the previous one is complete
+    //(a pivot row is final only after the elimination of the previous pivot, a panel only after
+    //the trailing update of the previous step)
+    int counter = 0;
+    while (counter < max && current_step <= last_step()) {
+        if (current_index == phase_size(current_step, current_phase)) {
+            if (counter > 0)
+                break;
+            current_index = 0;
+            if (++current_phase == 3) {
+                current_phase = 0;
+                current_step = next_step(current_step);
+            }
+            continue;
+        }
+        if (batch_groups > 0) {
+            input[counter].kind = PACKET_BATCH_MATRIX;
+            input[counter].begin = current_index * BATCH_GROUPS_MATRIX;
+            input[counter].end = input[counter].begin + BATCH_GROUPS_MATRIX < batch_groups ? input[counter].begin + BATCH_GROUPS_MATRIX : (int)batch_groups;
+            current_index++;
+        }
+        else if (solve_tiles > 0)
+            solve_packet(&input[counter], current_step, current_phase, current_index++);
+        else if (MATRIXENGINE == 2)
+            recursive_packet(&input[counter], current_step, current_index++);
+        else if (MATRIXENGINE == 1)
+            blocked_packet(&input[counter], current_step, current_phase, current_index++);
+        else
+            row_packet(&input[counter], current_step, current_phase, current_index++);
+        counter++;
+        howmanygenerated++;
+    }
+    return counter;
+}
+
+int owner_Matrix(const t_input_matrix* packet, int threads) {
+    //a row (row by row) or a tile (blocked and recursive LU, solves) goes to the same thread at every
+    //step, rows and tiles are dealt out cyclically so every thread keeps a part of the shrinking
+    //trailing matrix to the end
+    int unit = MATRIXENGINE == 2 ? RECURSIVE_TILE_MATRIX : MATRIXBLOCK;
+    int columns = (MATRIXSIZE + unit - 1) / unit;
+    int home;
+    if (batch_groups > 0)
+        home = packet->begin / BATCH_GROUPS_MATRIX;
+    else if (solve_tiles > 0)
+        home = packet->begin / MATRIXBLOCK * solve_tiles + packet->col_begin / SOLVE_COLUMNS_MATRIX;
+    else if (row_by_row())
+        home = packet->kind == PACKET_ROW_MATRIX ? packet->target_row_index : packet->begin;
+    else {
+        switch (packet->kind) {
+            case PACKET_GEMM_MATRIX: home = packet->begin / unit * columns + packet->col_begin / unit; break;
+            case PACKET_L21_MATRIX: home = packet->begin / unit * columns + packet->step / unit; break;
+            case PACKET_U12_MATRIX:
+            case PACKET_LEFT_MATRIX: home = packet->step / unit * columns + packet->begin / unit; break;
+            default: home = packet->step / unit * (columns + 1); break;
+        }
+    }
+    return home % threads;
+}
+
+int dependency_count_Matrix(void) {
+    //row by row: one token per row and per pivot search slot, blocked LU: one token per tile,
+    //batched mode: one token per packet, and a last token that is only ever read
+    if (batch_groups > 0)
+        return batch_packets + 1;
+    if (solve_tiles > 0) //one token per row block and column tile of the right-hand sides
+        return block_count(0) * solve_tiles + 1;
+    if (row_by_row()) //the Bareiss engine has one more token per step, for the inverse of its divisor
+        return MATRIXSIZE + search_count(0) + (MATRIXENGINE == 3 ? MATRIXSIZE : 0) + 1;
+    int tiles = block_count(0);
+    return tiles * tiles + 1;
+}
+
+static void tokens(t_tokens_matrix* list, int begin, int end, int stride) {
+    list->begin = begin;
+    list->end = end;
+    list->stride = stride;
+}
+
+int dependencies_Matrix(const t_input_matrix* packet, t_tokens_matrix* first, t_tokens_matrix* second, t_tokens_matrix* target) {
+    //tokens read (first, second) and written (target) by the packet, returns the task priority:
+    //1 - the packet is on the way to the next diagonal block, so the next panel can start early
+    int unused = dependency_count_Matrix() - 1;
+    tokens(first, unused, unused + 1, 1);
+    tokens(second, unused, unused + 1, 1);
+    int k = packet->step;
+    if (batch_groups > 0) {
+        tokens(target, packet->begin / BATCH_GROUPS_MATRIX, packet->begin / BATCH_GROUPS_MATRIX + 1, 1);
+        return 0;
+    }
+    if (solve_tiles > 0) {
+        int tile = packet->col_begin / SOLVE_COLUMNS_MATRIX;
+        int i = packet->begin / MATRIXBLOCK;
+        k /= MATRIXBLOCK;
+        switch (packet->kind) {
+            case PACKET_PERMUTE_MATRIX:
+                tokens(target, tile, block_count(0) * solve_tiles, solve_tiles);
+                return 1;
+            case PACKET_RHS_MATRIX:
+                tokens(first, k * solve_tiles + tile, k * solve_tiles + tile + 1, 1);
+                tokens(target, i * solve_tiles + tile, i * solve_tiles + tile + 1, 1);
+                return i == k + 1 || i == k - 1;
+            default:
+                tokens(target, i * solve_tiles + tile, i * solve_tiles + tile + 1, 1);
+                return 1;
+        }
+    }
+    if (row_by_row()) {
+        switch (packet->kind) {
+            case PACKET_SEARCH_MATRIX:
+                tokens(first, packet->begin, packet->end, 1);
+                tokens(target, MATRIXSIZE + (packet->begin - k) / PIVOT_ROWS_MATRIX, MATRIXSIZE + (packet->begin - k) / PIVOT_ROWS_MATRIX + 1, 1);
+                return 1;
+            case PACKET_SWAP_MATRIX:
+                if (!MATRIXPIVOT) {
+                    //Bareiss without pivoting: only the inverse of the divisor, a(k - 1, k - 1)
+                    if (k > 0)
+                        tokens(first, k - 1, k, 1);
+                    tokens(target, MATRIXSIZE + search_count(0) + k, MATRIXSIZE + search_count(0) + k + 1, 1);
+                    return 1;
+                }
+                //the pivot row is not known before the search, any row below the step may move
+                tokens(first, MATRIXSIZE, MATRIXSIZE + search_count(k), 1);
+                tokens(target, k, MATRIXSIZE, 1);
+                return 1;
+            default:
+                tokens(first, packet->pivot_row_index, packet->pivot_row_index + 1, 1);
+                //with pivoting the swap packet writes the pivot row token, which orders its divisor as well
+                if (MATRIXENGINE == 3 && !MATRIXPIVOT)
+                    tokens(second, MATRIXSIZE + search_count(0) + k, MATRIXSIZE + search_count(0) + k + 1, 1);
+                tokens(target, packet->target_row_index, packet->target_row_index + 1, 1);
+                return packet->target_row_index == packet->pivot_row_index + 1;
+        }
+    }
+    int nt = block_count(0);
+    int i = packet->begin / MATRIXBLOCK;
+    k /= MATRIXBLOCK;
+    switch (packet->kind) {
+        case PACKET_DIAG_MATRIX:
+            tokens(target, k * nt + k, k * nt + k + 1, 1);
+            return 1;
+        case PACKET_PANEL_MATRIX:
+            tokens(target, k * nt + k, nt * nt, nt);
+            return 1;
+        case PACKET_L21_MATRIX:
+            tokens(first, k * nt + k, k * nt + k + 1, 1);
+            tokens(target, i * nt + k, i * nt + k + 1, 1);
+            return 1;
+        case PACKET_U12_MATRIX:
+            //with pivoting the interchanges reach every tile of the block column below the step
+            tokens(first, k * nt + k, k * nt + k + 1, 1);
+            if (MATRIXPIVOT)
+                tokens(target, k * nt + i, nt * nt, nt);
+            else
+                tokens(target, k * nt + i, k * nt + i + 1, 1);
+            return 1;
+        case PACKET_LEFT_MATRIX:
+            //interchanges of the later panels, their diagonal tiles are last written by the panels
+            tokens(first, (i + 1) * (nt + 1), nt * nt, nt + 1);
+            tokens(target, (i + 1) * nt + i, nt * nt, nt);
+            return 0;
+        default: {
+            int j = packet->col_begin / MATRIXBLOCK;
+            tokens(first, i * nt + k, i * nt + k + 1, 1);
+            tokens(second, k * nt + j, k * nt + j + 1, 1);
+            tokens(target, i * nt + j, i * nt + j + 1, 1);
+            return i == k + 1 || j == k + 1;
+        }
+    }
+}
+
+//Row update kernels y -= a * x (and four rows at once for the trailing matrix tiles),
+//the widest instruction set of the CPU is selected by select_kernel_Matrix
+static void row_update_generic(double* restrict y, const double* restrict x, double a, int n) {
+	for (int j = 0; j < n; j++)
+		y[j] -= a * x[j];
+}
+
+static void row_update4_generic(double* restrict y0, double* restrict y1, double* restrict y2, double* restrict y3,
+	const double* restrict x, double a0, double a1, double a2, double a3, int n) {
+	for (int j = 0; j < n; j++) {
+		y0[j] -= a0 * x[j];
+		y1[j] -= a1 * x[j];
+		y2[j] -= a2 * x[j];
+		y3[j] -= a3 * x[j];
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void row_update_avx2(double* restrict y, const double* restrict x, double a, int n) {
+	__m256d va = _mm256_set1_pd(a);
+	int j = 0;
+	for (; j + 8 <= n; j += 8) {
+		__m256d y0 = _mm256_fnmadd_pd(va, _mm256_loadu_pd(x + j), _mm256_loadu_pd(y + j));
+		__m256d y1 = _mm256_fnmadd_pd(va, _mm256_loadu_pd(x + j + 4), _mm256_loadu_pd(y + j + 4));
+		_mm256_storeu_pd(y + j, y0);
+		_mm256_storeu_pd(y + j + 4, y1);
+	}
+	for (; j < n; j++)
+		y[j] = __builtin_fma(-a, x[j], y[j]);
+}
+
+__attribute__((target("avx2,fma")))
+static void row_update4_avx2(double* restrict y0, double* restrict y1, double* restrict y2, double* restrict y3,
+	const double* restrict x, double a0, double a1, double a2, double a3, int n) {
+	__m256d v0 = _mm256_set1_pd(a0), v1 = _mm256_set1_pd(a1), v2 = _mm256_set1_pd(a2), v3 = _mm256_set1_pd(a3);
+	int j = 0;
+	for (; j + 4 <= n; j += 4) {
+		__m256d vx = _mm256_loadu_pd(x + j);
+		_mm256_storeu_pd(y0 + j, _mm256_fnmadd_pd(v0, vx, _mm256_loadu_pd(y0 + j)));
+		_mm256_storeu_pd(y1 + j, _mm256_fnmadd_pd(v1, vx, _mm256_loadu_pd(y1 + j)));
+		_mm256_storeu_pd(y2 + j, _mm256_fnmadd_pd(v2, vx, _mm256_loadu_pd(y2 + j)));
+		_mm256_storeu_pd(y3 + j, _mm256_fnmadd_pd(v3, vx, _mm256_loadu_pd(y3 + j)));
+	}
+	for (; j < n; j++) {
+		y0[j] = __builtin_fma(-a0, x[j], y0[j]);
+		y1[j] = __builtin_fma(-a1, x[j], y1[j]);
+		y2[j] = __builtin_fma(-a2, x[j], y2[j]);
+		y3[j] = __builtin_fma(-a3, x[j], y3[j]);
+	}
+}
+
+__attribute__((target("avx512f")))
+static void row_update_avx512(double* restrict y, const double* restrict x, double a, int n) {
+	__m512d va = _mm512_set1_pd(a);
+	int j = 0;
+	for (; j + 8 <= n; j += 8)
+		_mm512_storeu_pd(y + j, _mm512_fnmadd_pd(va, _mm512_loadu_pd(x + j), _mm512_loadu_pd(y + j)));
+	if (j < n) {
+		//masked tail, no scalar loop
+		__mmask8 mask = (__mmask8)((1u << (n - j)) - 1);
+		__m512d vy = _mm512_maskz_loadu_pd(mask, y + j);
+		_mm512_mask_storeu_pd(y + j, mask, _mm512_fnmadd_pd(va, _mm512_maskz_loadu_pd(mask, x + j), vy));
+	}
+}
+
+__attribute__((target("avx512f")))
+static void row_update4_avx512(double* restrict y0, double* restrict y1, double* restrict y2, double* restrict y3,
+	const double* restrict x, double a0, double a1, double a2, double a3, int n) {
+	__m512d v0 = _mm512_set1_pd(a0), v1 = _mm512_set1_pd(a1), v2 = _mm512_set1_pd(a2), v3 = _mm512_set1_pd(a3);
+	for (int j = 0; j < n; j += 8) {
+		__mmask8 mask = n - j >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (n - j)) - 1);
+		__m512d vx = _mm512_maskz_loadu_pd(mask, x + j);
+		_mm512_mask_storeu_pd(y0 + j, mask, _mm512_fnmadd_pd(v0, vx, _mm512_maskz_loadu_pd(mask, y0 + j)));
+		_mm512_mask_storeu_pd(y1 + j, mask, _mm512_fnmadd_pd(v1, vx, _mm512_maskz_loadu_pd(mask, y1 + j)));
+		_mm512_mask_storeu_pd(y2 + j, mask, _mm512_fnmadd_pd(v2, vx, _mm512_maskz_loadu_pd(mask, y2 + j)));
+		_mm512_mask_storeu_pd(y3 + j, mask, _mm512_fnmadd_pd(v3, vx, _mm512_maskz_loadu_pd(mask, y3 + j)));
+	}
+}
+
+typedef void (*t_row_update_matrix)(double* restrict y, const double* restrict x, double a, int n);
+typedef void (*t_row_update4_matrix)(double* restrict y0, double* restrict y1, double* restrict y2, double* restrict y3,
+	const double* restrict x, double a0, double a1, double a2, double a3, int n);
+static t_row_update_matrix row_update = row_update_generic;
+static t_row_update4_matrix row_update4 = row_update4_generic;
+
+//Determinants of one lane group of the batched mode, Gaussian elimination with partial pivoting in
+//every lane at once: the pivot search and the interchange are selects instead of per-matrix branches,
+//so the lane loops are vectorised. The group is overwritten, det gets BATCH_LANES_MATRIX determinants.
+#define A_BATCH(i, j) (a + ((size_t)(i) * n + (j)) * BATCH_LANES_MATRIX)
+#define DEFINE_BATCH_KERNEL_MATRIX(name, TARGET) \
+TARGET static void name(double* restrict a, int n, int pivot, double* restrict det) { \
+	double d[BATCH_LANES_MATRIX], best[BATCH_LANES_MATRIX], inv[BATCH_LANES_MATRIX]; \
+	int row[BATCH_LANES_MATRIX]; \
+	for (int l = 0; l < BATCH_LANES_MATRIX; l++) \
+		d[l] = 1.0; \
+	for (int p = 0; p < n; p++) { \
+		double* ap = A_BATCH(p, 0); \
+		_Pragma("omp simd") \
+		for (int l = 0; l < BATCH_LANES_MATRIX; l++) { \
+			best[l] = fabs(ap[p * BATCH_LANES_MATRIX + l]); \
+			row[l] = p; \
+		} \
+		for (int i = p + 1; i < n && pivot; i++) { \
+			const double* ai = A_BATCH(i, p); \
+			_Pragma("omp simd") \
+			for (int l = 0; l < BATCH_LANES_MATRIX; l++) { \
+				int take = fabs(ai[l]) > best[l]; \
+				best[l] = take ? fabs(ai[l]) : best[l]; \
+				row[l] = take ? i : row[l]; \
+			} \
+		} \
+		/* rows chosen by no lane are skipped as a whole, the lanes that chose one swap it by select */ \
+		for (int i = p + 1; i < n && pivot; i++) { \
+			int chosen = 0; \
+			for (int l = 0; l < BATCH_LANES_MATRIX; l++) \
+				chosen |= row[l] == i; \
+			if (!chosen) \
+				continue; \
+			double* ai = A_BATCH(i, 0); \
+			for (int j = p; j < n; j++) { \
+				_Pragma("omp simd") \
+				for (int l = 0; l < BATCH_LANES_MATRIX; l++) { \
+					double x = ap[j * BATCH_LANES_MATRIX + l], y = ai[j * BATCH_LANES_MATRIX + l]; \
+					ap[j * BATCH_LANES_MATRIX + l] = row[l] == i ? y : x; \
+					ai[j * BATCH_LANES_MATRIX + l] = row[l] == i ? x : y; \
+				} \
+			} \
+		} \
+		/* a zero pivot (singular matrix) gets a zero factor instead of a division by zero */ \
+		_Pragma("omp simd") \
+		for (int l = 0; l < BATCH_LANES_MATRIX; l++) { \
+			double value = ap[p * BATCH_LANES_MATRIX + l]; \
+			d[l] = (row[l] != p ? -d[l] : d[l]) * value; \
+			inv[l] = value != 0.0 ? 1.0 / value : 0.0; \
+		} \
+		for (int i = p + 1; i < n; i++) { \
+			double* ai = A_BATCH(i, 0); \
+			double f[BATCH_LANES_MATRIX]; \
+			_Pragma("omp simd") \
+			for (int l = 0; l < BATCH_LANES_MATRIX; l++) \
+				f[l] = ai[p * BATCH_LANES_MATRIX + l] * inv[l]; \
+			for (int j = p + 1; j < n; j++) { \
+				_Pragma("omp simd") \
+				for (int l = 0; l < BATCH_LANES_MATRIX; l++) \
+					ai[j * BATCH_LANES_MATRIX + l] -= f[l] * ap[j * BATCH_LANES_MATRIX + l]; \
+			} \
+		} \
+	} \
+	for (int l = 0; l < BATCH_LANES_MATRIX; l++) \
+		det[l] = d[l]; \
+}
+
+DEFINE_BATCH_KERNEL_MATRIX(batch_generic, )
+DEFINE_BATCH_KERNEL_MATRIX(batch_avx2, __attribute__((target("avx2,fma"))))
+DEFINE_BATCH_KERNEL_MATRIX(batch_avx512, __attribute__((target("avx512f"))))
+
+typedef void (*t_batch_kernel_matrix)(double* restrict a, int n, int pivot, double* restrict det);
+static t_batch_kernel_matrix batch_kernel = batch_generic;
+
+int select_kernel_Matrix(int simd) {
+	//0 - best supported, 1 - generic C, 2 - AVX2, 3 - AVX-512 (lowered to what the CPU supports)
+	__builtin_cpu_init();
+	int best = __builtin_cpu_supports("avx512f") ? 3 : __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? 2 : 1;
+	if (simd == 0 || simd > best)
+		simd = best;
+	switch (simd) {
+		case 3: row_update = row_update_avx512; row_update4 = row_update4_avx512; batch_kernel = batch_avx512; matrix_kernel = "AVX-512"; break;
+		case 2: row_update = row_update_avx2; row_update4 = row_update4_avx2; batch_kernel = batch_avx2; matrix_kernel = "AVX2 FMA"; break;
+		default: row_update = row_update_generic; row_update4 = row_update4_generic; batch_kernel = batch_generic; matrix_kernel = "generic"; simd = 1; break;
+	}
+	return simd;
+}
+
+static void factor_diagonal(t_matrix* matrix, int k, int kb) {
+	//unblocked LU of the diagonal block, multipliers of L are stored below the diagonal
+	for (int p = k; p < k + kb; p++) {
+		const double* pivot = MATRIX_ROW(matrix, p);
+		for (int i = p + 1; i < k + kb; i++) {
+			double* row = MATRIX_ROW(matrix, i);
+			double factor = row[p] / pivot[p];
+			row[p] = factor;
+			row_update(row + p + 1, pivot + p + 1, factor, k + kb - p - 1);
+		}
+	}
+}
+
+static void solve_l21(t_matrix* matrix, int k, int kb, int begin, int end) {
+	//L21 = A21 * U11^-1, row by row
+	for (int i = begin; i < end; i++) {
+		double* row = MATRIX_ROW(matrix, i);
+		for (int p = k; p < k + kb; p++) {
+			double value = row[p];
+			for (int q = k; q < p; q++)
+				value -= row[q] * MATRIX_ROW(matrix, q)[p];
+			row[p] = value / MATRIX_ROW(matrix, p)[p];
+		}
+	}
+}
+
+static void solve_u12(t_matrix* matrix, int k, int kb, int begin, int end) {
+	//U12 = L11^-1 * A12 (unit lower triangular), the inner loop runs along the rows of the packet
+	for (int p = k + 1; p < k + kb; p++) {
+		double* row = MATRIX_ROW(matrix, p);
+		for (int q = k; q < p; q++)
+			row_update(row + begin, MATRIX_ROW(matrix, q) + begin, row[q], end - begin);
+	}
+}
+
+static void update_block(t_matrix* matrix, int k, int kb, int begin, int end, int j0, int n) {
+	//A22 -= L21 * U12 on one tile, four rows at a time so every loaded row of U12 is used four times
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		double* c0 = MATRIX_ROW(matrix, i), * c1 = MATRIX_ROW(matrix, i + 1);
+		double* c2 = MATRIX_ROW(matrix, i + 2), * c3 = MATRIX_ROW(matrix, i + 3);
+		for (int p = k; p < k + kb; p++)
+			row_update4(c0 + j0, c1 + j0, c2 + j0, c3 + j0, MATRIX_ROW(matrix, p) + j0, c0[p], c1[p], c2[p], c3[p], n);
+	}
+	for (; i < end; i++) {
+		double* c = MATRIX_ROW(matrix, i);
+		for (int p = k; p < k + kb; p++)
+			row_update(c + j0, MATRIX_ROW(matrix, p) + j0, c[p], n);
+	}
+}
+
+static void update_tile(t_matrix* matrix, int k, int kb, int begin, int end, int j0, int n) {
+	//halves the largest of the three dimensions until the L21, U12 and A22 parts fit in the L1/L2
+	//cache together, the inner dimension is split in order since both halves update the same tile
+	if (kb > RECURSIVE_BASE_MATRIX && kb >= end - begin && kb >= n) {
+		update_tile(matrix, k, kb / 2, begin, end, j0, n);
+		update_tile(matrix, k + kb / 2, kb - kb / 2, begin, end, j0, n);
+	}
+	else if (end - begin > RECURSIVE_BASE_MATRIX && end - begin >= n) {
+		//multiple of 4 rows for the four row kernel
+		int half = (end - begin) / 8 * 4;
+		update_tile(matrix, k, kb, begin, begin + half, j0, n);
+		update_tile(matrix, k, kb, begin + half, end, j0, n);
+	}
+	else if (n > RECURSIVE_BASE_MATRIX) {
+		//cache line aligned halves
+		int half = (j0 + n / 2) / 8 * 8 - j0;
+		update_tile(matrix, k, kb, begin, end, j0, half);
+		update_tile(matrix, k, kb, begin, end, j0 + half, n - half);
+	}
+	else {
+		update_block(matrix, k, kb, begin, end, j0, n);
+	}
+}
+
+static void solve_u12_recursive(t_matrix* matrix, int k, int kb, int begin, int end) {
+	//wide panels (recursive LU): solve the upper half, update the lower half with it, solve the lower half
+	if (kb <= RECURSIVE_BASE_MATRIX) {
+		solve_u12(matrix, k, kb, begin, end);
+		return;
+	}
+	int half = kb / 2;
+	solve_u12_recursive(matrix, k, half, begin, end);
+	update_tile(matrix, k, half, k + half, k + kb, begin, end - begin);
+	solve_u12_recursive(matrix, k + half, kb - half, begin, end);
+}
+
+static void swap_rows(t_matrix* matrix, int i, int p, int col_begin, int col_end) {
+	double* a = MATRIX_ROW(matrix, i);
+	double* b = MATRIX_ROW(matrix, p);
+	for (int j = col_begin; j < col_end; j++) {
+		double t = a[j];
+		a[j] = b[j];
+		b[j] = t;
+	}
+}
+
+static void record_interchange(t_matrix* matrix, int i, int p) {
+	matrix->ipiv[i] = p;
+	int t = matrix->perm[i];
+	matrix->perm[i] = matrix->perm[p];
+	matrix->perm[p] = t;
+}
+
+static void apply_interchanges(t_matrix* matrix, int from, int to, int col_begin, int col_end) {
+	//interchanges of the steps from .. to - 1 in their order, on the given columns only
+	for (int i = from; i < to; i++)
+		if (matrix->ipiv[i] != i)
+			swap_rows(matrix, i, matrix->ipiv[i], col_begin, col_end);
+}
+
+static void search_pivot(t_matrix* matrix, const t_input_matrix* packet) {
+	//largest |value| of the pivot column in the rows of the packet, ties go to the upper row
+	int k = packet->step;
+	int slot = (packet->begin - k) / PIVOT_ROWS_MATRIX;
+	double best = -1.0;
+	int row = packet->begin;
+	for (int i = packet->begin; i < packet->end; i++) {
+		double value = fabs(MATRIX_ROW(matrix, i)[k]);
+		if (value > best) {
+			best = value;
+			row = i;
+		}
+	}
+	matrix->pivot_value[slot] = best;
+	matrix->pivot_index[slot] = row;
+}
+
+static void swap_pivot(t_matrix* matrix, int k) {
+	//reduction of the search packets of the step, slots are in row order so ties still go up
+	int best = 0;
+	for (int slot = 1; slot < search_count(k); slot++)
+		if (matrix->pivot_value[slot] > matrix->pivot_value[best])
+			best = slot;
+	int p = matrix->pivot_index[best];
+	record_interchange(matrix, k, p);
+	if (p != k && matrix->exact != NULL)
+		swap_exact_Matrix(matrix, k, p);
+	else if (p != k)
+		swap_rows(matrix, k, p, 0, MATRIXSIZE);
+}
+
+static void factor_panel(t_matrix* matrix, int k, int kb) {
+	//unblocked LU of the columns k .. k + kb - 1 down to the last row with partial pivoting,
+	//rows are interchanged inside the panel only, the U12 and the LEFT packets do the other columns
+	for (int p = k; p < k + kb; p++) {
+		int best = p;
+		double value = fabs(MATRIX_ROW(matrix, p)[p]);
+		for (int i = p + 1; i < MATRIXSIZE; i++) {
+			if (fabs(MATRIX_ROW(matrix, i)[p]) > value) {
+				value = fabs(MATRIX_ROW(matrix, i)[p]);
+				best = i;
+			}
+		}
+		if (!MATRIXPIVOT)
+			best = p; //the recursive LU factors its leaves without interchanges too
+		record_interchange(matrix, p, best);
+		if (best != p)
+			swap_rows(matrix, p, best, k, k + kb);
+		const double* pivot = MATRIX_ROW(matrix, p);
+		if (pivot[p] == 0.0)
+			continue; //zero column, the matrix is singular
+		for (int i = p + 1; i < MATRIXSIZE; i++) {
+			double* row = MATRIX_ROW(matrix, i);
+			double factor = row[p] / pivot[p];
+			row[p] = factor;
+			row_update(row + p + 1, pivot + p + 1, factor, k + kb - p - 1);
+		}
+	}
+}
+
+//Triangular solves with the factors, on the columns c0 .. c1 - 1 of the right-hand sides
+
+static void permute_rhs(t_matrix* matrix, int c0, int c1) {
+	t_rhs_matrix* rhs = matrix->rhs;
+	for (int i = 0; i < MATRIXSIZE; i++) {
+		if (matrix->ipiv[i] == i)
+			continue;
+		double* a = RHS_ROW(rhs, i);
+		double* b = RHS_ROW(rhs, matrix->ipiv[i]);
+		for (int j = c0; j < c1; j++) {
+			double t = a[j];
+			a[j] = b[j];
+			b[j] = t;
+		}
+	}
+}
+
+static void solve_lower(t_matrix* matrix, int k, int kb, int c0, int c1) {
+	//unit diagonal, L is below the diagonal of the factors
+	t_rhs_matrix* rhs = matrix->rhs;
+	for (int i = k + 1; i < k + kb; i++) {
+		const double* l = MATRIX_ROW(matrix, i);
+		for (int p = k; p < i; p++)
+			row_update(RHS_ROW(rhs, i) + c0, RHS_ROW(rhs, p) + c0, l[p], c1 - c0);
+	}
+}
+
+static void solve_upper(t_matrix* matrix, int k, int kb, int c0, int c1) {
+	t_rhs_matrix* rhs = matrix->rhs;
+	for (int i = k + kb - 1; i >= k; i--) {
+		const double* u = MATRIX_ROW(matrix, i);
+		double* x = RHS_ROW(rhs, i);
+		for (int p = i + 1; p < k + kb; p++)
+			row_update(x + c0, RHS_ROW(rhs, p) + c0, u[p], c1 - c0);
+		for (int j = c0; j < c1; j++)
+			x[j] /= u[i];
+	}
+}
+
+static void update_rhs(t_matrix* matrix, int k, int kb, int begin, int end, int c0, int c1) {
+	//rows below the block use L, rows above it U, four rows at a time as in update_block
+	t_rhs_matrix* rhs = matrix->rhs;
+	int n = c1 - c0;
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		const double* a0 = MATRIX_ROW(matrix, i), * a1 = MATRIX_ROW(matrix, i + 1);
+		const double* a2 = MATRIX_ROW(matrix, i + 2), * a3 = MATRIX_ROW(matrix, i + 3);
+		for (int p = k; p < k + kb; p++)
+			row_update4(RHS_ROW(rhs, i) + c0, RHS_ROW(rhs, i + 1) + c0, RHS_ROW(rhs, i + 2) + c0, RHS_ROW(rhs, i + 3) + c0,
+				RHS_ROW(rhs, p) + c0, a0[p], a1[p], a2[p], a3[p], n);
+	}
+	for (; i < end; i++) {
+		const double* a = MATRIX_ROW(matrix, i);
+		for (int p = k; p < k + kb; p++)
+			row_update(RHS_ROW(rhs, i) + c0, RHS_ROW(rhs, p) + c0, a[p], n);
+	}
+}
+
+static void process_batch(t_matrix* matrix, int begin, int end) {
+	t_batch_matrix* batch = matrix->batch;
+	double det[BATCH_LANES_MATRIX];
+	for (int g = begin; g < end; g++) {
+		batch_kernel(BATCH_GROUP_MATRIX(batch, g), batch->order, MATRIXPIVOT, det);
+		for (int l = 0; l < BATCH_LANES_MATRIX && (long)g * BATCH_LANES_MATRIX + l < batch->count; l++)
+			batch->determinant[(long)g * BATCH_LANES_MATRIX + l] = det[l];
+	}
+}
+
+void process_Matrix(t_input_matrix* data, t_matrix* matrix) {
+
+	if (data->kind != PACKET_ROW_MATRIX) {
+		int k = data->step;
+		int kb = data->width;
+		switch (data->kind) {
+			case PACKET_DIAG_MATRIX: factor_diagonal(matrix, k, kb); break;
+			case PACKET_PANEL_MATRIX: factor_panel(matrix, k, kb); break;
+			case PACKET_L21_MATRIX: solve_l21(matrix, k, kb, data->begin, data->end); break;
+			case PACKET_U12_MATRIX:
+				if (MATRIXPIVOT)
+					apply_interchanges(matrix, k, k + kb, data->begin, data->end);
+				solve_u12_recursive(matrix, k, kb, data->begin, data->end);
+				break;
+			case PACKET_GEMM_MATRIX: update_tile(matrix, k, kb, data->begin, data->end, data->col_begin, data->col_end - data->col_begin); break;
+			case PACKET_LEFT_MATRIX: apply_interchanges(matrix, k, k + kb, data->begin, data->end); break;
+			case PACKET_SEARCH_MATRIX:
+				if (matrix->exact != NULL)
+					search_exact_Matrix(matrix, k, data->begin, data->end, (data->begin - k) / PIVOT_ROWS_MATRIX);
+				else
+					search_pivot(matrix, data);
+				break;
+			case PACKET_SWAP_MATRIX:
+				if (MATRIXPIVOT)
+					swap_pivot(matrix, k);
+				if (matrix->exact != NULL)
+					divisor_exact_Matrix(matrix, k);
+				break;
+			case PACKET_BATCH_MATRIX: process_batch(matrix, data->begin, data->end); break;
+			default: {
+				int c0 = data->col_begin;
+				int c1 = data->col_end;
+				switch (data->kind) {
+					case PACKET_PERMUTE_MATRIX: permute_rhs(matrix, c0, c1); break;
+					case PACKET_LOWER_MATRIX: solve_lower(matrix, k, kb, c0, c1); break;
+					case PACKET_UPPER_MATRIX: solve_upper(matrix, k, kb, c0, c1); break;
+					case PACKET_RHS_MATRIX: update_rhs(matrix, k, kb, data->begin, data->end, c0, c1); break;
+				}
+			}
+		}
+		return;
+	}
+
+	int pivot_row_index = data->pivot_row_index;
+	int target_row_index = data->target_row_index;
+	if (matrix->exact != NULL) {
+		eliminate_exact_Matrix(matrix, pivot_row_index, target_row_index);
+		return;
+	}
+	double* pivot = MATRIX_ROW(matrix, pivot_row_index);
+	double* target = MATRIX_ROW(matrix, target_row_index);
+
+	if (pivot[pivot_row_index] == 0.0)
+		return; //zero column below the pivot (with pivoting), the matrix is singular
+	//columns left of the pivot are already zero in both rows, the multiplier is kept in place of the zero
+	double factor = target[pivot_row_index] / pivot[pivot_row_index];
+	target[pivot_row_index] = factor;
+	row_update(target + pivot_row_index + 1, pivot + pivot_row_index + 1, factor, MATRIXSIZE - pivot_row_index - 1);
+	return;
+}
+
+long double determinant(t_matrix* matrix) {
+    long double det = 1.0;
+	for (int i = 0; i < MATRIXSIZE; i++) {
+		det *= MATRIX_ROW(matrix, i)[i];
+		if (matrix->ipiv[i] != i)
+			det = -det;
+	}
+	return det;
+}
+
+int log_determinant_Matrix(t_matrix* matrix, long double* log_abs) {
+	//sign of the determinant (0 - singular) and log|det|, which does not overflow for any size
+	if (matrix->exact != NULL)
+		return log_exact_determinant_Matrix(matrix, log_abs);
+	int sign = 1;
+	long double sum = 0.0L;
+	for (int i = 0; i < MATRIXSIZE; i++) {
+		double value = MATRIX_ROW(matrix, i)[i];
+		if (value == 0.0) {
+			*log_abs = -INFINITY;
+			return 0;
+		}
+		if (value < 0.0)
+			sign = -sign;
+		if (matrix->ipiv[i] != i)
+			sign = -sign;
+		sum += logl(fabsl((long double)value));
+	}
+	*log_abs = sum;
+	return sign;
+}
+
+int leading_dimension_Matrix(int size) {
+    //rows start on cache lines, a row length of a multiple of 4 KiB would make the same column
+    //of consecutive rows alias in the L1 cache and the store buffer
+    int ld = (size + 7) / 8 * 8;
+    if (ld * sizeof(double) % 4096 == 0)
+        ld += 8;
+    return ld;
+}
+
+t_matrix* attach_Matrix(int size, double* data) {
+    t_matrix* matrix = (t_matrix*)malloc(sizeof(t_matrix));
+    if (matrix == NULL) {
+        perror("Memory allocation failed (matrix)");
+        exit(EXIT_FAILURE);
+    }
+    matrix->size = size;
+    matrix->ld = leading_dimension_Matrix(size);
+    matrix->data = data;
+    int slots = (size + PIVOT_ROWS_MATRIX - 1) / PIVOT_ROWS_MATRIX + 1;
+    matrix->perm = (int*)malloc(sizeof(int) * (size > 0 ? size : 1));
+    matrix->ipiv = (int*)malloc(sizeof(int) * (size > 0 ? size : 1));
+    matrix->pivot_value = (double*)malloc(sizeof(double) * slots);
+    matrix->pivot_index = (int*)malloc(sizeof(int) * slots);
+    if (matrix->perm == NULL || matrix->ipiv == NULL || matrix->pivot_value == NULL || matrix->pivot_index == NULL) {
+        perror("Memory allocation failed (pivots)");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < size; i++)
+        matrix->perm[i] = matrix->ipiv[i] = i;
+    matrix->batch = NULL;
+    matrix->mapping = NULL;
+    matrix->mapping_size = 0;
+    matrix->exact = NULL;
+    matrix->rhs = NULL;
+    return matrix;
+}
+
+t_matrix* allocate_Matrix(int size) {
+    double* data = (double*)aligned_alloc(64, sizeof(double) * (size_t)leading_dimension_Matrix(size) * (size > 0 ? size : 1));
+    if (data == NULL) {
+        perror("Memory allocation failed (matrix data)");
+        exit(EXIT_FAILURE);
+    }
+    return attach_Matrix(size, data);
+}
+
+t_batch_matrix* allocate_batch_Matrix(int order, long count) {
+    t_batch_matrix* batch = (t_batch_matrix*)malloc(sizeof(t_batch_matrix));
+    if (batch == NULL) {
+        perror("Memory allocation failed (batch)");
+        exit(EXIT_FAILURE);
+    }
+    batch->order = order;
+    batch->count = count;
+    batch->groups = (count + BATCH_LANES_MATRIX - 1) / BATCH_LANES_MATRIX;
+    size_t group_size = (size_t)order * order * BATCH_LANES_MATRIX;
+    batch->data = (double*)aligned_alloc(64, sizeof(double) * (group_size * batch->groups > 0 ? group_size * batch->groups : BATCH_LANES_MATRIX));
+    batch->determinant = (double*)malloc(sizeof(double) * (count > 0 ? count : 1));
+    if (batch->data == NULL || batch->determinant == NULL) {
+        perror("Memory allocation failed (batch data)");
+        exit(EXIT_FAILURE);
+    }
+    return batch;
+}
+
+t_rhs_matrix* allocate_rhs_Matrix(int rows, int cols) {
+    t_rhs_matrix* rhs = (t_rhs_matrix*)malloc(sizeof(t_rhs_matrix));
+    if (rhs == NULL) {
+        perror("Memory allocation failed (right-hand sides)");
+        exit(EXIT_FAILURE);
+    }
+    rhs->rows = rows;
+    rhs->cols = cols;
+    rhs->ld = leading_dimension_Matrix(cols);
+    rhs->data = (double*)aligned_alloc(64, sizeof(double) * (size_t)rhs->ld * (rows > 0 ? rows : 1));
+    if (rhs->data == NULL) {
+        perror("Memory allocation failed (right-hand sides)");
+        exit(EXIT_FAILURE);
+    }
+    return rhs;
+}
+
+void free_rhs_Matrix(t_rhs_matrix* rhs) {
+    free(rhs->data);
+    free(rhs);
+}
+
+t_rhs_matrix* generateRhsMatrix(int rows, int cols, unsigned int seed, int threadnum) {
+    //uniform in [-1, 1), the streams of generateRandomMatrix
+    t_rhs_matrix* rhs = allocate_rhs_Matrix(rows, cols);
+
+    #pragma omp parallel for schedule(static) num_threads(threadnum)
+    for (int i = 0; i < rows; i++) {
+        unsigned long long state = ((unsigned long long)seed << 32) ^ (unsigned long long)i * 0x9E3779B97F4A7C15ULL;
+        double* row = RHS_ROW(rhs, i);
+        for (int j = 0; j < cols; j++) {
+            unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            z ^= z >> 31;
+            row[j] = (double)(z >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+        }
+    }
+
+    return rhs;
+}
+
+t_batch_matrix* generateBatchMatrix(const t_matrix* source, long count, unsigned int seed, int threadnum) {
+    //count copies of the source matrix, or random matrices of its order (one splitmix64 stream per
+    //matrix) if seed is not 0, the unused lanes of the last group hold identity matrices
+    int n = source->size;
+    t_batch_matrix* batch = allocate_batch_Matrix(n, count);
+
+    //the lanes of a group share cache lines, a group is written by one thread
+    #pragma omp parallel for schedule(static, BATCH_LANES_MATRIX) num_threads(threadnum)
+    for (long index = 0; index < batch->groups * BATCH_LANES_MATRIX; index++) {
+        double* a = BATCH_GROUP_MATRIX(batch, index / BATCH_LANES_MATRIX) + index % BATCH_LANES_MATRIX;
+        unsigned long long state = ((unsigned long long)seed << 32) ^ (unsigned long long)index * 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                double value;
+                if (index >= count) {
+                    value = i == j;
+                }
+                else if (seed != 0) {
+                    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+                    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                    z ^= z >> 31;
+                    value = (double)(z >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+                }
+                else {
+                    value = MATRIX_ROW(source, i)[j];
+                }
+                a[((size_t)i * n + j) * BATCH_LANES_MATRIX] = value;
+            }
+        }
+    }
+    return batch;
+}
+
+long double batch_reference_Matrix(const t_batch_matrix* batch, long index) {
+    //scalar Gaussian elimination with partial pivoting in long double, for checking the batched kernels
+    int n = batch->order;
+    const double* a = BATCH_GROUP_MATRIX(batch, index / BATCH_LANES_MATRIX) + index % BATCH_LANES_MATRIX;
+    long double* m = (long double*)malloc(sizeof(long double) * (n > 0 ? n * n : 1));
+    if (m == NULL) {
+        perror("Memory allocation failed (reference)");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n * n; i++)
+        m[i] = a[(size_t)i * BATCH_LANES_MATRIX];
+    long double det = 1.0L;
+    for (int p = 0; p < n && det != 0.0L; p++) {
+        int best = p;
+        for (int i = p + 1; i < n; i++)
+            if (fabsl(m[i * n + p]) > fabsl(m[best * n + p]))
+                best = i;
+        if (best != p) {
+            det = -det;
+            for (int j = 0; j < n; j++) {
+                long double t = m[p * n + j];
+                m[p * n + j] = m[best * n + j];
+                m[best * n + j] = t;
+            }
+        }
+        det *= m[p * n + p];
+        for (int i = p + 1; i < n && m[p * n + p] != 0.0L; i++) {
+            long double factor = m[i * n + p] / m[p * n + p];
+            for (int j = p + 1; j < n; j++)
+                m[i * n + j] -= factor * m[p * n + j];
+        }
+    }
+    free(m);
+    return det;
+}
+
+void free_Matrix(t_matrix* matrix) {
+    if (matrix->batch != NULL) {
+        free(matrix->batch->data);
+        free(matrix->batch->determinant);
+        free(matrix->batch);
+    }
+    if (matrix->exact != NULL)
+        free_exact_Matrix(matrix->exact);
+    if (matrix->mapping != NULL)
+        munmap(matrix->mapping, matrix->mapping_size);
+    else
+        free(matrix->data);
+    free(matrix->perm);
+    free(matrix->ipiv);
+    free(matrix->pivot_value);
+    free(matrix->pivot_index);
+    free(matrix);
+}
+
+t_matrix* generateVandermondeMatrix(int size, int threadnum) {
+    t_matrix* matrix = allocate_Matrix(size);
+
+    //first touch: every thread writes, and so places, the pages of an even share of the rows,
+    //the powers are built by multiplication in double-double, rounded they are the values of pow()
+    #pragma omp parallel for schedule(static) num_threads(threadnum)
+    for (int i = 0; i < size; i++) {
+        double base = (double)(i + 1);  // x_i
+        double* row = MATRIX_ROW(matrix, i);
+        double hi = 1.0, lo = 0.0;
+        for (int j = 0; j < size; j++) {
+            row[j] = hi;  // x_i^j
+            double product = hi * base;
+            if (isinf(product)) {
+                hi = product;
+                continue;
+            }
+            double error = lo * base + fma(hi, base, -product);
+            hi = product + error;
+            lo = error - (hi - product);
+        }
+    }
+
+    return matrix;
+}
+
+t_matrix* generateRandomMatrix(int size, unsigned int seed, int threadnum) {
+    //uniform in [-1, 1), every row has its own splitmix64 stream, so rows can be generated in any order
+    t_matrix* matrix = allocate_Matrix(size);
+
+    #pragma omp parallel for schedule(static) num_threads(threadnum)
+    for (int i = 0; i < size; i++) {
+        unsigned long long state = ((unsigned long long)seed << 32) ^ (unsigned long long)i * 0x9E3779B97F4A7C15ULL;
+        double* row = MATRIX_ROW(matrix, i);
+        for (int j = 0; j < size; j++) {
+            unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            z ^= z >> 31;
+            row[j] = (double)(z >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+        }
+    }
+
+    return matrix;
+}
+
+t_matrix* generateRandomIntegerMatrix(int size, unsigned int seed, int range, int threadnum) {
+    //the streams of generateRandomMatrix, scaled to the 2 * range + 1 integers
+    t_matrix* matrix = generateRandomMatrix(size, seed, threadnum);
+
+    #pragma omp parallel for schedule(static) num_threads(threadnum)
+    for (int i = 0; i < size; i++) {
+        double* row = MATRIX_ROW(matrix, i);
+        for (int j = 0; j < size; j++) {
+            double value = floor((row[j] + 1.0) * 0.5 * (2.0 * range + 1.0)) - range;
+            row[j] = value > range ? range : value;
+        }
+    }
+
+    return matrix;
+}
+
+long double vandermondeLogDeterminant(int size) {
+    //log of prod (x_j - x_i) for x_i = i + 1, the difference d appears size - d times
+    long double sum = 0.0L;
+    for (int d = 1; d < size; d++)
+        sum += (size - d) * logl((long double)d);
+    return sum;
+}
+
+long double vandermondeDeterminant(int size) {
+	double* x = (double*)malloc(size * sizeof(double));
+    if (x == NULL) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+	for (int i = 1; i <= size; i++) {
+		x[i - 1] = (double)i;
+	}
+    long double det = 1.0;
+    for (int i = 0; i < size - 1; i++) {
+        for (int j = i + 1; j < size; j++) {
+            det *= (x[j] - x[i]);
+        }
+    }
+    free(x);
+    return det;
 }
\ No newline at end of file
@@ -1,26 +1,144 @@
-#ifndef MATRIXDETERMINANT_H
-#define MATRIXDETERMINANT_H
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <omp.h>
-#include <math.h>
-
-extern int BUFFERSIZEMATRIX;
-extern int CHUNKCOUNTMATRIX;
-extern int MATRIXSIZE;
-
-typedef struct {
-    int pivot_row_index;
-    int target_row_index;
-} t_input_matrix;
-
-long generate_new_input_Matrix(t_input_matrix* input, double** matrix);
-void process_Matrix(t_input_matrix* data, double**matrix);
-long double determinant(double** matrix);
-
-double** generateVandermondeMatrix(int size);
-long double vandermondeDeterminant(int size);
-
-
+#ifndef MATRIXDETERMINANT_H
+#define MATRIXDETERMINANT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <math.h>
+
+extern int BUFFERSIZEMATRIX;
+extern int CHUNKCOUNTMATRIX;
+extern int MATRIXSIZE;
+extern int MATRIXENGINE; //0 - row by row elimination, 1 - blocked LU, 2 - recursive LU, 3 - Bareiss
+extern int MATRIXBLOCK; //Panel width and tile size of the blocked LU
+extern int MATRIXPIVOT; //1 - partial pivoting
+extern const char* matrix_kernel; //Instruction set of the row update kernel in use
+
+#define PIVOT_ROWS_MATRIX 256 //rows of the pivot column searched by one packet
+#define RECURSIVE_LEAF_MATRIX 16 //columns of the recursive LU factored by one panel packet
+#define RECURSIVE_TILE_MATRIX 256 //rows and columns of the recursive LU packets (parallelism only)
+#define RECURSIVE_BASE_MATRIX 64 //largest update the recursive LU does not split inside a packet
+
+#define BATCH_LANES_MATRIX 8 //matrices of the batched mode computed together, one vector lane each
+#define BATCH_GROUPS_MATRIX 64 //lane groups of the batched mode in one packet
+
+//Batched mode: count small matrices of one order in a structure of arrays, element (i, j) of the
+//matrices of lane group g is at BATCH_GROUP_MATRIX(batch, g)[(i * order + j) * BATCH_LANES_MATRIX + lane]
+typedef struct {
+    double* data;
+    int order;
+    long count;
+    long groups;
+    double* determinant; // result for every matrix
+} t_batch_matrix;
+
+#define BATCH_GROUP_MATRIX(batch, g) ((batch)->data + (size_t)(g) * (batch)->order * (batch)->order * BATCH_LANES_MATRIX)
+
+//Exact copy of the matrix for the Bareiss engine, element (i, j) is at data + (i * ld + j) * limbs
+typedef struct {
+    unsigned long long* data;
+    int limbs; // 64 bit words of every element, enough for the determinant
+    int* width; // words of the operands and results of every step, at most limbs
+    int ld;
+    unsigned long long* inverse; // inverse of the odd part of the divisor of every step, limbs words each
+    int* shift; // trailing zero bits of the divisor of every step
+    unsigned long long* scratch; // multi-limb temporaries, scratch_limbs words per thread
+    size_t scratch_limbs;
+} t_exact_matrix;
+
+//Right-hand sides of the triangular solves, rows x cols row-major with ld doubles per row,
+//they are overwritten by the solution
+typedef struct {
+    double* data;
+    int rows;
+    int cols;
+    int ld;
+} t_rhs_matrix;
+
+#define RHS_ROW(rhs, i) ((rhs)->data + (size_t)(i) * (rhs)->ld)
+#define SOLVE_COLUMNS_MATRIX 256 // right-hand sides of one solve packet
+
+//Contiguous matrix, rows start on 64 byte boundaries, ld - padded row length in doubles
+typedef struct {
+    double* data;
+    int size;
+    int ld;
+    int* perm; // original index of every row after the interchanges
+    int* ipiv; // row interchanged with row i at step i
+    double* pivot_value; // largest |value| found by every pivot search packet of the step
+    int* pivot_index; // and its row
+    t_batch_matrix* batch; // batched mode instead of this matrix, NULL - one matrix
+    void* mapping; // file mapping holding data, NULL - data is allocated
+    t_exact_matrix* exact; // integer copy of the Bareiss engine, NULL - other engines
+    t_rhs_matrix* rhs; // right-hand sides solved with the factors of this matrix, NULL - factorisation
+    size_t mapping_size;
+} t_matrix;
+
+#define MATRIX_ROW(matrix, i) ((matrix)->data + (size_t)(i) * (matrix)->ld)
+
+//Packet kinds
+#define PACKET_ROW_MATRIX 0 // target row -= factor * pivot row
+#define PACKET_DIAG_MATRIX 1 // LU of the diagonal block
+#define PACKET_L21_MATRIX 2 // rows of the panel below the diagonal block
+#define PACKET_U12_MATRIX 3 // columns of the block row right of the diagonal block
+#define PACKET_GEMM_MATRIX 4 // tile of the trailing matrix
+#define PACKET_SEARCH_MATRIX 5 // pivot search in a part of the pivot column
+#define PACKET_SWAP_MATRIX 6 // choice of the pivot row and the interchange, the Bareiss divisor of the step
+#define PACKET_PANEL_MATRIX 7 // LU of the whole panel with partial pivoting
+#define PACKET_LEFT_MATRIX 8 // interchanges of the later steps on the L part of a block column
+#define PACKET_BATCH_MATRIX 9 // lane groups begin .. end - 1 of the batched mode
+#define PACKET_PERMUTE_MATRIX 10 // interchanges of the factorisation on a column tile of the right-hand sides
+#define PACKET_LOWER_MATRIX 11 // forward substitution with the diagonal block of L
+#define PACKET_UPPER_MATRIX 12 // back substitution with the diagonal block of U
+#define PACKET_RHS_MATRIX 13 // rows begin .. end - 1 of the right-hand sides -= A(rows, block) * X(block)
+
+typedef struct {
+    int pivot_row_index;
+    int target_row_index;
+    int kind;
+    int step; // first row and column of the diagonal block (blocked and recursive LU)
+    int width; // columns of the diagonal block, LEFT: interchanges of the rows step .. step + width - 1
+    int begin; // rows (L21, GEMM, SEARCH) or columns (U12, LEFT) of the packet
+    int end;
+    int col_begin; // columns of a GEMM tile, right-hand sides of a solve packet
+    int col_end;
+} t_input_matrix;
+
+//Dependency tokens of a packet: begin, begin + stride, ... below end
+typedef struct {
+    int begin;
+    int end;
+    int stride;
+} t_tokens_matrix;
+
+void prepare_Matrix(t_matrix* matrix, int engine, int block, int pivot, int threads);
+int select_kernel_Matrix(int simd);
+long generate_new_input_Matrix(t_input_matrix* input, t_matrix* matrix);
+int owner_Matrix(const t_input_matrix* packet, int threads);
+int dependency_count_Matrix(void);
+int dependencies_Matrix(const t_input_matrix* packet, t_tokens_matrix* first, t_tokens_matrix* second, t_tokens_matrix* target);
+void process_Matrix(t_input_matrix* data, t_matrix* matrix);
+long double determinant(t_matrix* matrix);
+int log_determinant_Matrix(t_matrix* matrix, long double* log_abs);
+
+int leading_dimension_Matrix(int size);
+t_matrix* allocate_Matrix(int size);
+//matrix over rows laid out by the caller with leading_dimension_Matrix(size) doubles per row
+t_matrix* attach_Matrix(int size, double* data);
+t_batch_matrix* allocate_batch_Matrix(int order, long count);
+t_rhs_matrix* allocate_rhs_Matrix(int rows, int cols);
+void free_rhs_Matrix(t_rhs_matrix* rhs);
+void free_Matrix(t_matrix* matrix);
+//the generators run on threadnum threads, which place the pages of an even share of the rows
+t_matrix* generateVandermondeMatrix(int size, int threadnum);
+long double vandermondeDeterminant(int size);
+long double vandermondeLogDeterminant(int size);
+t_matrix* generateRandomMatrix(int size, unsigned int seed, int threadnum);
+//integers in [-range, range] instead of [-1, 1)
+t_matrix* generateRandomIntegerMatrix(int size, unsigned int seed, int range, int threadnum);
+t_rhs_matrix* generateRhsMatrix(int rows, int cols, unsigned int seed, int threadnum);
+t_batch_matrix* generateBatchMatrix(const t_matrix* source, long count, unsigned int seed, int threadnum);
+long double batch_reference_Matrix(const t_batch_matrix* batch, long index);
+
+
 #endif
\ No newline at end of file
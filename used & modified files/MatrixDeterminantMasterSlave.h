@@ -1,19 +1,41 @@
-#ifndef MATRIXDETERMINANTMasterSlave_H
-#define MATRIXDETERMINANTMasterSlave_H
-#include "MatrixDeterminant.h"
-
-typedef struct {
-	int size;
-	int vandermonde;
-	int model;
-	int prefab;
-	int thread_num;
-	int buffer_size;
-}SettingsMatrix;
-
-int dynamicForMatrixDeterminant(double** matrix, SettingsMatrix settings);
-int taskingMatrixDeterminant(double** matrix, SettingsMatrix settings);
-int integratedMasterMatrixDeterminant(double** matrix, SettingsMatrix settings);
-void print_progress(int percent);
-
+#ifndef MATRIXDETERMINANTMasterSlave_H
+#define MATRIXDETERMINANTMasterSlave_H
+#include "MatrixDeterminant.h"
+#include "Affinity.h"
+
+typedef struct {
+	int size;
+	int vandermonde;
+	int model;
+	int prefab;
+	int thread_num;
+	int buffer_size;
+	int engine; // 0 - row by row elimination, 1 - blocked LU, 2 - recursive LU, 3 - Bareiss
+	int block; // panel width and tile size of the blocked LU
+	int report; // 1 - print working time, GFLOP/s and energy
+	int simd; // row update kernel: 0 - best supported, 1 - generic, 2 - AVX2, 3 - AVX-512
+	int pivot; // 1 - partial pivoting
+	unsigned int random; // seed of a random matrix, 0 - no random matrix
+	int integers; // entries of the random matrix are integers in [-integers, integers], 0 - in [-1, 1)
+	long batch; // batched mode: number of matrices of order size, 0 - one matrix
+	const char* input; // binary matrix file to load instead of generating, NULL - no file
+	const char* dump; // binary matrix file to write the input to, NULL - no file
+	int solve; // right-hand sides solved with the factors afterwards, 0 - no solve
+	int affinity; // 1 - owner-computes queues in the dynamic model, rows and tiles stay with one thread
+}SettingsMatrix;
+
+int dynamicForMatrixDeterminant(t_matrix* matrix, SettingsMatrix settings);
+int taskingMatrixDeterminant(t_matrix* matrix, SettingsMatrix settings);
+int integratedMasterMatrixDeterminant(t_matrix* matrix, SettingsMatrix settings);
+int dataflowMatrixDeterminant(t_matrix* matrix, SettingsMatrix settings);
+//LU factorisation with the model and engine of the settings (floating point engines): the matrix
+//is replaced by L below the diagonal (unit diagonal not stored) and U on and above it, with
+//P A = L U, row i of P A is row perm[i] of A, ipiv[i] the row interchanged with row i at step i.
+//In the batched mode every matrix of the batch is factored instead.
+int factorMatrix(t_matrix* matrix, SettingsMatrix settings);
+//Solves A X = B with the factors of factorMatrix, B is overwritten by X, the factors are kept
+//so they can be used for any number of solves
+int solveMatrix(t_matrix* lu, t_rhs_matrix* rhs, SettingsMatrix settings);
+void print_progress(int percent);
+
 #endif
\ No newline at end of file
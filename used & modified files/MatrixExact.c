@@ -0,0 +1,374 @@
+#include "MatrixExact.h"
+#include <string.h>
+
+typedef unsigned long long t_limb;
+typedef unsigned __int128 t_wide;
+
+#define EXACT_ELEMENT(exact, i, j) ((exact)->data + ((size_t)(i) * (exact)->ld + (j)) * (exact)->limbs)
+
+int integer_Matrix(const t_matrix* matrix) {
+    for (int i = 0; i < matrix->size; i++) {
+        const double* row = MATRIX_ROW(matrix, i);
+        for (int j = 0; j < matrix->size; j++)
+            if (row[j] != floor(row[j]) || fabs(row[j]) > 9007199254740992.0)
+                return 0;
+    }
+    return 1;
+}
+
+static int compare_descending(const void* a, const void* b) {
+    long double x = *(const long double*)a, y = *(const long double*)b;
+    return (x < y) - (x > y);
+}
+
+static int limbs_for(long double bits) {
+    //magnitude bits, a sign bit and one bit for the rounding of the logarithms
+    int limbs = (int)ceill((bits + 2.0L) / 64.0L);
+    return limbs > 0 ? limbs : 1;
+}
+
+void prepare_exact_Matrix(t_matrix* matrix, int threads) {
+    int n = matrix->size;
+    if (matrix->exact != NULL)
+        free_exact_Matrix(matrix->exact);
+    t_exact_matrix* exact = (t_exact_matrix*)malloc(sizeof(t_exact_matrix));
+    long double* norm = (long double*)malloc(sizeof(long double) * (n > 0 ? n : 1));
+    if (exact == NULL || norm == NULL) {
+        perror("Memory allocation failed (exact matrix)");
+        exit(EXIT_FAILURE);
+    }
+
+    //Hadamard: an m x m minor is at most the product of the m largest row norms, the results of
+    //step k are minors of order k + 2, its operands and divisor smaller ones
+    for (int i = 0; i < n; i++) {
+        long double sum = 0.0L;
+        const double* row = MATRIX_ROW(matrix, i);
+        for (int j = 0; j < n; j++)
+            sum += (long double)row[j] * row[j];
+        norm[i] = sum > 1.0L ? 0.5L * log2l(sum) : 0.0L; //a zero row makes the determinant 0 anyway
+    }
+    qsort(norm, n, sizeof(long double), compare_descending);
+    exact->width = (int*)malloc(sizeof(int) * (n > 0 ? n : 1));
+    if (exact->width == NULL) {
+        perror("Memory allocation failed (exact matrix)");
+        exit(EXIT_FAILURE);
+    }
+    long double bits = 0.0L;
+    for (int m = 1; m <= n; m++) {
+        bits += norm[m - 1];
+        if (m >= 2)
+            exact->width[m - 2] = limbs_for(bits);
+    }
+    exact->width[n > 0 ? n - 1 : 0] = limbs_for(bits);
+    free(norm);
+
+    exact->limbs = exact->width[n > 0 ? n - 1 : 0];
+    exact->ld = matrix->ld;
+    exact->data = (t_limb*)malloc(sizeof(t_limb) * exact->limbs * (size_t)exact->ld * (n > 0 ? n : 1));
+    if (exact->data == NULL) {
+        perror("Memory allocation failed (exact matrix data)");
+        exit(EXIT_FAILURE);
+    }
+    //a step works on at most twice its width (the divisor's factor 2^t is one more width at most),
+    //the row packets need six such numbers and two of the width, rounded to cache lines per thread
+    exact->scratch_limbs = ((size_t)14 * exact->limbs + 7) / 8 * 8;
+    exact->scratch = (t_limb*)malloc(sizeof(t_limb) * exact->scratch_limbs * threads);
+    exact->inverse = (t_limb*)malloc(sizeof(t_limb) * exact->limbs * (n > 0 ? n : 1));
+    exact->shift = (int*)malloc(sizeof(int) * (n > 0 ? n : 1));
+    if (exact->scratch == NULL || exact->inverse == NULL || exact->shift == NULL) {
+        perror("Memory allocation failed (exact scratch)");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        const double* row = MATRIX_ROW(matrix, i);
+        for (int j = 0; j < n; j++) {
+            t_limb* element = EXACT_ELEMENT(exact, i, j);
+            long long value = (long long)row[j];
+            element[0] = (t_limb)value;
+            for (int l = 1; l < exact->limbs; l++)
+                element[l] = value < 0 ? ~0ULL : 0ULL;
+        }
+    }
+    matrix->exact = exact;
+}
+
+void free_exact_Matrix(t_exact_matrix* exact) {
+    free(exact->data);
+    free(exact->width);
+    free(exact->inverse);
+    free(exact->shift);
+    free(exact->scratch);
+    free(exact);
+}
+
+static int is_zero(const t_limb* x, int w) {
+    for (int l = 0; l < w; l++)
+        if (x[l] != 0)
+            return 0;
+    return 1;
+}
+
+//Multi-limb routines, all of them modulo 2^(64 m), so they hold for negative values as well
+
+static void load(t_limb* r, const t_limb* x, int w, int m) {
+    //the w valid limbs of an element, sign extended to m
+    int copied = w < m ? w : m;
+    memcpy(r, x, sizeof(t_limb) * copied);
+    t_limb sign = (long long)x[w - 1] < 0 ? ~0ULL : 0ULL;
+    for (int l = copied; l < m; l++)
+        r[l] = sign;
+}
+
+static void store(t_limb* element, const t_limb* x, int w, int ext) {
+    memcpy(element, x, sizeof(t_limb) * w);
+    t_limb sign = (long long)x[w - 1] < 0 ? ~0ULL : 0ULL;
+    for (int l = w; l < ext; l++)
+        element[l] = sign;
+}
+
+static void mul_low(t_limb* restrict r, const t_limb* restrict a, const t_limb* restrict b, int m) {
+    memset(r, 0, sizeof(t_limb) * m);
+    for (int i = 0; i < m; i++) {
+        if (a[i] == 0)
+            continue;
+        t_limb carry = 0;
+        for (int j = 0; i + j < m; j++) {
+            t_wide t = (t_wide)a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = (t_limb)t;
+            carry = (t_limb)(t >> 64);
+        }
+    }
+}
+
+static void sub(t_limb* r, const t_limb* a, const t_limb* b, int m) {
+    t_limb borrow = 0;
+    for (int l = 0; l < m; l++) {
+        t_limb x = a[l] - b[l];
+        t_limb next = (a[l] < b[l]) | (x < borrow);
+        r[l] = x - borrow;
+        borrow = next;
+    }
+}
+
+static void shift_right(t_limb* r, const t_limb* x, int t, int w, int m) {
+    //low w limbs of x >> t, x has m >= w + ceil(t / 64) limbs
+    int words = t / 64, bits = t % 64;
+    for (int l = 0; l < w; l++) {
+        t_limb low = x[l + words] >> bits;
+        t_limb high = bits != 0 && l + words + 1 < m ? x[l + words + 1] << (64 - bits) : 0;
+        r[l] = low | high;
+    }
+}
+
+static int trailing_zeros(const t_limb* x, int w) {
+    for (int l = 0; l < w; l++)
+        if (x[l] != 0)
+            return 64 * l + __builtin_ctzll(x[l]);
+    return 64 * w;
+}
+
+static t_wide inverse_wide(t_wide d) {
+    //Newton for odd d: x d = 1 mod 2^3 at the start, every step doubles the correct bits
+    t_wide x = d;
+    for (int i = 0; i < 6; i++)
+        x *= 2 - d * x;
+    return x;
+}
+
+static void inverse(t_limb* x, const t_limb* d, int w, t_limb* t, t_limb* u) {
+    memset(x, 0, sizeof(t_limb) * w);
+    x[0] = (t_limb)inverse_wide(d[0]);
+    for (int bits = 64; bits < 64 * w; bits *= 2) {
+        mul_low(t, d, x, w);
+        //u = 2 - d x
+        memset(u, 0, sizeof(t_limb) * w);
+        u[0] = 2;
+        sub(u, u, t, w);
+        mul_low(t, x, u, w);
+        memcpy(x, t, sizeof(t_limb) * w);
+    }
+}
+
+static t_wide load_wide(const t_limb* x, int w) {
+    return w == 1 ? (t_wide)(__int128)(long long)x[0] : ((t_wide)x[1] << 64) | x[0];
+}
+
+static void store_wide(t_limb* element, t_wide value, int w, int ext) {
+    t_limb x[2] = { (t_limb)value, (t_limb)(value >> 64) };
+    store(element, x, w, ext);
+}
+
+static t_limb* scratch_exact(const t_exact_matrix* exact) {
+    return exact->scratch + exact->scratch_limbs * omp_get_thread_num();
+}
+
+void divisor_exact_Matrix(t_matrix* matrix, int k) {
+    //exact division by d = 2^t d': the row packets shift by t and multiply by the inverse of the odd d'
+    t_exact_matrix* exact = matrix->exact;
+    int w = exact->width[k];
+    t_limb* inv = exact->inverse + (size_t)k * exact->limbs;
+    memset(inv, 0, sizeof(t_limb) * w);
+    inv[0] = 1;
+    exact->shift[k] = 0;
+    const t_limb* divisor = k > 0 ? EXACT_ELEMENT(exact, k - 1, k - 1) : NULL;
+    if (divisor == NULL || is_zero(divisor, w))
+        return; //the first step divides by 1, a zero divisor makes the row packets skip the step
+    int t = trailing_zeros(divisor, w);
+    int m = w + (t + 63) / 64;
+    t_limb* scratch = scratch_exact(exact);
+    t_limb *a = scratch, *b = a + m, *x = b + m, *y = x + w;
+    load(a, divisor, w, m);
+    shift_right(b, a, t, w, m);
+    inverse(inv, b, w, x, y);
+    exact->shift[k] = t;
+}
+
+void eliminate_exact_Matrix(t_matrix* matrix, int k, int i) {
+    t_exact_matrix* exact = matrix->exact;
+    int n = matrix->size;
+    int w = exact->width[k];
+    //the results are read again by the next two steps (the divisor of step k + 2 is one of them)
+    int ext = exact->width[k + 2 < n ? k + 2 : n - 1];
+    const t_limb* pivot = EXACT_ELEMENT(exact, k, 0);
+    t_limb* row = EXACT_ELEMENT(exact, i, 0);
+    const t_limb* divisor = k > 0 ? EXACT_ELEMENT(exact, k - 1, k - 1) : NULL;
+    int L = exact->limbs;
+
+    if (is_zero(pivot + (size_t)k * L, w) || (divisor != NULL && is_zero(divisor, w)))
+        return; //zero pivot without pivoting, or a zero column, the matrix is singular
+    //the product is needed modulo 2^(64 w + t), the inverse comes from the swap packet of the step
+    int t = exact->shift[k];
+    int m = w + (t + 63) / 64;
+    const t_limb* inv = exact->inverse + (size_t)k * L;
+
+    if (m <= 2) {
+        t_wide p = load_wide(pivot + (size_t)k * L, w);
+        t_wide f = load_wide(row + (size_t)k * L, w);
+        t_wide d = w == 1 ? inv[0] : ((t_wide)inv[1] << 64) | inv[0];
+        for (int j = k + 1; j < n; j++) {
+            t_wide x = p * load_wide(row + (size_t)j * L, w) - f * load_wide(pivot + (size_t)j * L, w);
+            store_wide(row + (size_t)j * L, (x >> t) * d, w, ext);
+        }
+        return;
+    }
+
+    t_limb* scratch = scratch_exact(exact);
+    t_limb *p = scratch, *f = p + m, *a = f + m, *b = a + m, *x = b + m, *y = x + m;
+    t_limb *s = y + m, *q = s + w;
+    load(p, pivot + (size_t)k * L, w, m);
+    load(f, row + (size_t)k * L, w, m);
+    for (int j = k + 1; j < n; j++) {
+        load(a, row + (size_t)j * L, w, m);
+        load(b, pivot + (size_t)j * L, w, m);
+        mul_low(x, p, a, m);
+        mul_low(y, f, b, m);
+        sub(x, x, y, m);
+        shift_right(s, x, t, w, m);
+        mul_low(q, s, inv, w);
+        store(row + (size_t)j * L, q, w, ext);
+    }
+}
+
+void search_exact_Matrix(t_matrix* matrix, int k, int begin, int end, int slot) {
+    //any nonzero pivot keeps the division exact, the first one interchanges the fewest rows
+    t_exact_matrix* exact = matrix->exact;
+    matrix->pivot_value[slot] = 0.0;
+    matrix->pivot_index[slot] = begin;
+    for (int i = begin; i < end; i++) {
+        if (!is_zero(EXACT_ELEMENT(exact, i, k), exact->width[k])) {
+            matrix->pivot_value[slot] = 1.0;
+            matrix->pivot_index[slot] = i;
+            return;
+        }
+    }
+}
+
+void swap_exact_Matrix(t_matrix* matrix, int i, int p) {
+    t_exact_matrix* exact = matrix->exact;
+    t_limb* a = EXACT_ELEMENT(exact, i, 0);
+    t_limb* b = EXACT_ELEMENT(exact, p, 0);
+    for (size_t l = 0; l < (size_t)matrix->size * exact->limbs; l++) {
+        t_limb t = a[l];
+        a[l] = b[l];
+        b[l] = t;
+    }
+}
+
+static int determinant_magnitude(const t_matrix* matrix, t_limb* magnitude) {
+    //|last pivot| and the sign of the determinant, every interchange flips it
+    const t_exact_matrix* exact = matrix->exact;
+    int n = matrix->size;
+    int L = exact->limbs;
+    const t_limb* last = EXACT_ELEMENT(exact, n - 1, n - 1);
+    for (int k = 0; k < n; k++)
+        if (is_zero(EXACT_ELEMENT(exact, k, k), exact->width[k]))
+            return 0; //zero pivot, the later steps were skipped
+    int sign = (long long)last[L - 1] < 0 ? -1 : 1;
+    memcpy(magnitude, last, sizeof(t_limb) * L);
+    if (sign < 0) {
+        t_limb carry = 1;
+        for (int l = 0; l < L; l++) {
+            magnitude[l] = ~magnitude[l] + carry;
+            carry = carry && magnitude[l] == 0;
+        }
+    }
+    for (int k = 0; k < n; k++)
+        if (matrix->ipiv[k] != k)
+            sign = -sign;
+    return sign;
+}
+
+int log_exact_determinant_Matrix(const t_matrix* matrix, long double* log_abs) {
+    int L = matrix->exact->limbs;
+    t_limb* magnitude = (t_limb*)malloc(sizeof(t_limb) * L);
+    if (magnitude == NULL) {
+        perror("Memory allocation failed (determinant)");
+        exit(EXIT_FAILURE);
+    }
+    int sign = determinant_magnitude(matrix, magnitude);
+    *log_abs = -INFINITY;
+    if (sign != 0) {
+        int top = L - 1;
+        while (top > 0 && magnitude[top] == 0)
+            top--;
+        long double value = (long double)magnitude[top];
+        if (top > 0)
+            value = value * 18446744073709551616.0L + (long double)magnitude[top - 1];
+        *log_abs = logl(value) + (top > 0 ? top - 1 : 0) * 64 * logl(2.0L);
+    }
+    free(magnitude);
+    return sign;
+}
+
+char* exact_determinant_Matrix(const t_matrix* matrix, char* text, size_t length) {
+    //groups of 19 digits by repeated division by 10^19, the last group first
+    int L = matrix->exact->limbs;
+    t_limb* magnitude = (t_limb*)malloc(sizeof(t_limb) * L);
+    t_limb* groups = (t_limb*)malloc(sizeof(t_limb) * (L * 20 / 19 + 2));
+    if (magnitude == NULL || groups == NULL) {
+        perror("Memory allocation failed (determinant)");
+        exit(EXIT_FAILURE);
+    }
+    int sign = determinant_magnitude(matrix, magnitude);
+    int count = 0;
+    int top = L;
+    if (sign == 0)
+        top = 0;
+    while (top > 0) {
+        t_wide rest = 0;
+        for (int l = top - 1; l >= 0; l--) {
+            t_wide value = (rest << 64) | magnitude[l];
+            magnitude[l] = (t_limb)(value / 10000000000000000000ULL);
+            rest = value % 10000000000000000000ULL;
+        }
+        groups[count++] = (t_limb)rest;
+        while (top > 0 && magnitude[top - 1] == 0)
+            top--;
+    }
+    size_t used = snprintf(text, length, "%s%llu", sign < 0 ? "-" : "", count > 0 ? groups[count - 1] : 0ULL);
+    for (int g = count - 2; g >= 0 && used < length; g--)
+        used += snprintf(text + used, length - used, "%019llu", groups[g]);
+    free(magnitude);
+    free(groups);
+    return text;
+}
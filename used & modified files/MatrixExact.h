@@ -0,0 +1,29 @@
+#ifndef MATRIXEXACT_H
+#define MATRIXEXACT_H
+#include "MatrixDeterminant.h"
+
+//Fraction-free (Bareiss) elimination of integer matrices, engine 3. Step k replaces the entries
+//below and right of the pivot by (a(k, k) a(i, j) - a(i, k) a(k, j)) / a(k - 1, k - 1), the division
+//is exact and every entry stays a minor of the input, so the last pivot is the determinant itself.
+//Entries are two's complement integers of 64 bit limbs. Steps whose minors fit in the Hadamard bound
+//of two limbs run on __int128, the later ones on the multi-limb routines, each step with only the
+//limbs its minors can need. The row packets of the row by row engine do one row each, the swap
+//packet of every step (generated also without pivoting) inverts the divisor once for all of them.
+
+//1 - every entry is an integer of at most 53 bits, so the double holds it exactly
+int integer_Matrix(const t_matrix* matrix);
+//exact copy of the matrix, sized by the Hadamard bound, and the scratch of threads threads
+void prepare_exact_Matrix(t_matrix* matrix, int threads);
+void free_exact_Matrix(t_exact_matrix* exact);
+//inverse of the odd part of the divisor of step k, before the row packets of the step
+void divisor_exact_Matrix(t_matrix* matrix, int k);
+void eliminate_exact_Matrix(t_matrix* matrix, int k, int i);
+//first row of begin .. end - 1 with a nonzero entry in column k, pivot_value 1 - found, 0 - none
+void search_exact_Matrix(t_matrix* matrix, int k, int begin, int end, int slot);
+void swap_exact_Matrix(t_matrix* matrix, int i, int p);
+//sign of the determinant and log|det| (-INFINITY for 0)
+int log_exact_determinant_Matrix(const t_matrix* matrix, long double* log_abs);
+//decimal digits of the determinant, returns text
+char* exact_determinant_Matrix(const t_matrix* matrix, char* text, size_t length);
+
+#endif
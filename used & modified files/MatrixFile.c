@@ -0,0 +1,155 @@
+#include "MatrixFile.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static double element(const unsigned char* data, int dtype, size_t index) {
+	if (dtype == MATRIX_FILE_FLOAT32) {
+		float value;
+		memcpy(&value, data + index * sizeof(float), sizeof(float));
+		return value;
+	}
+	double value;
+	memcpy(&value, data + index * sizeof(double), sizeof(double));
+	return value;
+}
+
+t_matrix* load_Matrix(const char* filename, int threadnum, int* mapped) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		perror("open");
+		return NULL;
+	}
+	t_matrix_file_header header;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(header)
+		|| pread(fd, &header, sizeof(header), 0) != sizeof(header) || memcmp(header.magic, MATRIX_FILE_MAGIC, 8) != 0) {
+		printf("%s is not a matrix file\n", filename);
+		close(fd);
+		return NULL;
+	}
+	//the sizes are bounded by division against the file before any product is formed, so a header
+	//cannot make them wrap around
+	size_t element_size = header.dtype == MATRIX_FILE_FLOAT32 ? sizeof(float) : sizeof(double);
+	size_t available = (size_t)info.st_size - sizeof(header);
+	if ((header.dtype != MATRIX_FILE_FLOAT64 && header.dtype != MATRIX_FILE_FLOAT32) || header.rows != header.cols
+		|| header.rows < 1 || header.ld < header.cols || header.count < 1
+		|| (size_t)header.ld > available / element_size / (size_t)header.rows
+		|| (uint64_t)header.count > available / ((size_t)header.rows * header.ld * element_size)) {
+		printf("%s: unsupported or truncated matrix (%d x %d, dtype %d, ld %d, count %lld)\n", filename,
+			header.rows, header.cols, header.dtype, header.ld, (long long)header.count);
+		close(fd);
+		return NULL;
+	}
+	int n = header.rows;
+	size_t matrix_size = (size_t)header.rows * header.ld * element_size;
+	size_t file_size = sizeof(header) + matrix_size * header.count;
+
+	//the rows are used in place when they have exactly the layout allocate_Matrix would give them,
+	//private pages are copied only when the elimination writes them, MAP_POPULATE reads the file
+	//before the measured part starts
+	int ld = leading_dimension_Matrix(n);
+	*mapped = header.dtype == MATRIX_FILE_FLOAT64 && header.count == 1 && header.ld == ld;
+	unsigned char* map = (unsigned char*)mmap(NULL, file_size, *mapped ? PROT_READ | PROT_WRITE : PROT_READ,
+		MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		return NULL;
+	}
+	if (*mapped) {
+		t_matrix* matrix = attach_Matrix(n, (double*)(map + sizeof(header)));
+		matrix->mapping = map;
+		matrix->mapping_size = file_size;
+		return matrix;
+	}
+
+	const unsigned char* data = map + sizeof(header);
+	t_matrix* matrix = allocate_Matrix(n);
+	//first touch: every thread writes, and so places, the pages of an even share of the rows
+	#pragma omp parallel for schedule(static) num_threads(threadnum)
+	for (int i = 0; i < n; i++) {
+		double* row = MATRIX_ROW(matrix, i);
+		for (int j = 0; j < n; j++)
+			row[j] = element(data, header.dtype, (size_t)i * header.ld + j);
+	}
+	if (header.count > 1) {
+		matrix->batch = allocate_batch_Matrix(n, header.count);
+		t_batch_matrix* batch = matrix->batch;
+		#pragma omp parallel for schedule(static) num_threads(threadnum)
+		for (long g = 0; g < batch->groups; g++) {
+			double* group = BATCH_GROUP_MATRIX(batch, g);
+			for (int l = 0; l < BATCH_LANES_MATRIX; l++) {
+				long index = g * BATCH_LANES_MATRIX + l;
+				for (int i = 0; i < n; i++)
+					for (int j = 0; j < n; j++)
+						group[((size_t)i * n + j) * BATCH_LANES_MATRIX + l] = index < batch->count
+							? element(data, header.dtype, (size_t)index * header.rows * header.ld + (size_t)i * header.ld + j)
+							: i == j;
+			}
+		}
+	}
+	munmap(map, file_size);
+	return matrix;
+}
+
+int dump_Matrix(const char* filename, const t_matrix* matrix, int threadnum) {
+	const t_batch_matrix* batch = matrix->batch;
+	t_matrix_file_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MATRIX_FILE_MAGIC, 8);
+	header.rows = header.cols = matrix->size;
+	header.dtype = MATRIX_FILE_FLOAT64;
+	header.ld = matrix->ld;
+	header.count = batch != NULL ? batch->count : 1;
+	size_t matrix_size = sizeof(double) * (size_t)header.rows * header.ld;
+	if ((size_t)header.ld > SIZE_MAX / sizeof(double) / (size_t)header.rows
+		|| (uint64_t)header.count > (SIZE_MAX - sizeof(header)) / matrix_size) {
+		printf("%s: %lld matrices of %d x %d do not fit in one file\n", filename, (long long)header.count,
+			header.rows, header.cols);
+		return -1;
+	}
+	size_t file_size = sizeof(header) + matrix_size * header.count;
+
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror("open");
+		return -1;
+	}
+	if (ftruncate(fd, file_size) != 0) {
+		perror("ftruncate");
+		close(fd);
+		return -1;
+	}
+	unsigned char* map = (unsigned char*)mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		close(fd);
+		return -1;
+	}
+	memcpy(map, &header, sizeof(header));
+	double* data = (double*)(map + sizeof(header));
+	int n = header.rows;
+
+	#pragma omp parallel for schedule(static) num_threads(threadnum)
+	for (long r = 0; r < header.count * n; r++) {
+		long index = r / n;
+		int i = (int)(r % n);
+		double* out = data + (size_t)r * header.ld;
+		memset(out, 0, sizeof(double) * header.ld);
+		for (int j = 0; j < n; j++)
+			out[j] = batch != NULL
+				? BATCH_GROUP_MATRIX(batch, index / BATCH_LANES_MATRIX)[((size_t)i * n + j) * BATCH_LANES_MATRIX + index % BATCH_LANES_MATRIX]
+				: MATRIX_ROW(matrix, i)[j];
+	}
+
+	if (munmap(map, file_size) != 0) {
+		perror("munmap");
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef MATRIXFILE_H
+#define MATRIXFILE_H
+#include "MatrixDeterminant.h"
+#include <stdint.h>
+
+//Binary matrix file: a 64 byte header followed by count matrices of rows x cols elements,
+//stored row-major with ld elements per row, in the byte order of the machine
+#define MATRIX_FILE_MAGIC "MXMATRIX"
+#define MATRIX_FILE_FLOAT64 1
+#define MATRIX_FILE_FLOAT32 2
+
+typedef struct {
+	char magic[8];
+	int32_t rows;
+	int32_t cols;
+	int32_t dtype; // MATRIX_FILE_FLOAT64 or MATRIX_FILE_FLOAT32
+	int32_t ld; // elements per stored row, at least cols
+	int64_t count; // matrices in the file, more than one - batched mode
+	unsigned char reserved[32];
+} t_matrix_file_header;
+
+//Loads a square matrix file. A single float64 matrix whose rows already have the padded layout of
+//allocate_Matrix is mapped copy-on-write (mapped = 1), everything else is copied in parallel by
+//threadnum threads, each thread touching the rows it will most likely work on first (mapped = 0).
+//More than one matrix gives the batched mode: matrix->batch holds all of them, matrix the first one.
+//Returns NULL after printing the reason if the file cannot be used.
+t_matrix* load_Matrix(const char* filename, int threadnum, int* mapped);
+//Writes the matrix (all matrices of the batched mode) as float64 with the padded row length
+int dump_Matrix(const char* filename, const t_matrix* matrix, int threadnum);
+
+#endif
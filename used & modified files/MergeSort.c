@@ -1,117 +1,427 @@
-#include "MergeSort.h"
-
-int BUFFERSIZE;
-int arraySize;
-int CHUNKCOUNT;
-
-long generate_new_input_sort(t_input_sort* input, int* array) { // returned value: how many items generated
-
-	static int level = 1; //level of recursion for example level 1 has 2^1=2 elements in input
-    static int howmanygenerated = 0;
-	static int done_phases_this_level = 0; //only one layer of recursion is done at a time
-    int pow = 1 << level;
-	int total_phases_this_level = arraySize / pow; //max number of phases in this level
-	int forced = arraySize - pow * total_phases_this_level; //how many elements are left to be sorted and has to be added to the last input
-
-
-    int counter = 0;
-	//maximum number of elements to be generated this time
-    int max = BUFFERSIZE;
-    if (BUFFERSIZE > (CHUNKCOUNT - howmanygenerated))
-        max = CHUNKCOUNT - howmanygenerated;
-
-    for (counter = 0;counter < max;counter++) {
-		//this is for the last phase of the last level
-        if (pow >= arraySize) {
-            input[counter].left = array;
-            input[counter].middle = arraySize / 2 - 1;
-            input[counter].size = arraySize;
-            input[counter].force = 0;
-        }
-        //standard case
-        else {
-            input[counter].left = &(array[(1 << level) * done_phases_this_level]);
-            input[counter].middle = (1 << (level - 1)) - 1;
-            input[counter].size = (1 << level);
-            input[counter].force = 0;
-        }
-        howmanygenerated++;
-        done_phases_this_level++;
-        //if there is remaining elements, add them to the last input
-        #ifdef _DEBUG
-            int input_left_idx = input[counter].left - array; 
-            int input_size = input[counter].size;
-            int input_middle = input[counter].middle;
-            int input_force = input[counter].force;
-        #endif
-        if (done_phases_this_level == total_phases_this_level) {
-            if (forced) {
-                input[counter].force = forced;
-                #ifdef _DEBUG
-                    input_force = input[counter].force;
-                #endif
-            }
-            counter++;
-            #ifdef _DEBUG
-                FILE* fp = fopen("debug.txt", "a");
-                fprintf(fp, "left: %d, middle: %d, size: %d, force: %d, level: %d, done_phases_this_level: %d, total_phases_this_level: %d, pow: %d, forced: %d\n", input_left_idx, input_middle, input_size, input_force, level, done_phases_this_level, total_phases_this_level, pow, forced);
-                fclose(fp);
-            #endif
-            break;
-        }
-        #ifdef _DEBUG
-            FILE* fp = fopen("debug.txt", "a");
-            fprintf(fp, "left: %d, middle: %d, size: %d, force: %d, level: %d, done_phases_this_level: %d, total_phases_this_level: %d, pow: %d, forced: %d\n", input_left_idx, input_middle, input_size, input_force, level, done_phases_this_level, total_phases_this_level, pow, forced);
-            fclose(fp);
-        #endif
-    }
-	//if level is done, go to the next level
-    if (done_phases_this_level >= total_phases_this_level) {
-        level++;
-        done_phases_this_level = 0;
-
-    }
-	
-    return counter;
-
-}
-
-void process_sort(t_input_sort* data) {
-
-	//temporary array for merging
-    int* temp = (int*)malloc(sizeof(int) * data->size);
-    if (temp == NULL) {
-        perror("Memory allocation failed");
-        exit(EXIT_FAILURE);
-    }
-    //sorting
-    int i = 0, j = data->middle + 1, k = 0;
-    while (i <= data->middle && j < data->size) {
-        if (data->left[i] < data->left[j]) {
-            temp[k++] = data->left[i++];
-        }
-        else {
-            temp[k++] = data->left[j++];
-        }
-    }
-	//copying the rest of the elements
-    while (i <= data->middle) temp[k++] = data->left[i++];
-    while (j < data->size) temp[k++] = data->left[j++];
-
-	//copying the sorted elements back to the original array
-    for (i = 0; i < data->size; i++) {
-        data->left[i] = temp[i];
-    }
-	//free the temporary array
-    free(temp);
-    //Do it again with the remaining elements
-	//This is called only when the array size is not a power of two and only in the last input
-    //This is called max once per level
-    if (data->force) {
-        data->middle = data->size - 1;
-        data->size = data->size + data->force;
-        data->force = 0;
-        process_sort(data);
-    }
-}
-
+#include "MergeSort.h"
+#include "MergeSortRadix.h"
+
+#include <string.h>
+#include <immintrin.h>
+
+int BUFFERSIZE;
+int arraySize;
+int CHUNKCOUNT;
+const char* sort_kernel = "insertion sort";
+int sort_algorithm = ALGO_MERGE_SORT;
+
+typedef struct {
+    int* data;
+    long capacity;
+    char padding[64 - sizeof(int*) - sizeof(long)]; // one arena per cache line
+} t_sort_arena;
+
+static t_sort_arena* sort_arenas = NULL;
+static int sort_threads = 0;
+static int* pingpong_buffer = NULL; // second buffer of the ping-pong mode and of the split levels
+static int sort_pingpong = 0;
+static int sort_levels = 0;
+static int split_level = 0;
+
+int parts_sort(int level, int threads) {
+    //a level of fewer merges than threads splits every merge in sub-merges of equal output size,
+    //enough for all threads but not below a leaf block each
+    int merges = arraySize >> level;
+    if (level <= SORT_LEAF_LEVEL || merges >= threads || merges == 0)
+        return 1;
+    int parts = (threads + merges - 1) / merges;
+    int most = 1 << (level - SORT_LEAF_LEVEL);
+    return parts < most ? parts : most;
+}
+
+void prepare_sort(int threads, int pingpong, int algorithm) {
+    sort_threads = threads;
+    sort_algorithm = algorithm;
+    sort_arenas = (t_sort_arena*)calloc(threads, sizeof(t_sort_arena));
+    if (sort_arenas == NULL) {
+        perror("Memory allocation failed (arenas)");
+        exit(EXIT_FAILURE);
+    }
+    sort_levels = SORT_LEAF_LEVEL;
+    while (sort_levels < 30 && (2 << sort_levels) <= arraySize)
+        sort_levels++;
+    //the first level with fewer merges than threads, the sub-merges of its merges cannot work in place
+    split_level = SORT_LEAF_LEVEL + 1;
+    while (split_level <= sort_levels && parts_sort(split_level, threads) == 1)
+        split_level++;
+    sort_pingpong = pingpong;
+    if (algorithm == ALGO_RADIX_SORT)
+        prepare_radix_sort(threads);
+    if (pingpong || split_level <= sort_levels || algorithm == ALGO_RADIX_SORT) {
+        pingpong_buffer = (int*)malloc(sizeof(int) * (arraySize > 0 ? arraySize : 1));
+        if (pingpong_buffer == NULL) {
+            perror("Memory allocation failed (ping-pong buffer)");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void finish_sort(void) {
+    for (int t = 0; t < sort_threads; t++)
+        free(sort_arenas[t].data);
+    free(sort_arenas);
+    free(pingpong_buffer);
+    if (sort_algorithm == ALGO_RADIX_SORT)
+        free_radix_sort();
+    sort_arenas = NULL;
+    pingpong_buffer = NULL;
+}
+
+static void leaf_insertion(int* a) {
+    for (int i = 1; i < SORT_LEAF; i++) {
+        int value = a[i];
+        int j = i - 1;
+        while (j >= 0 && a[j] > value) {
+            a[j + 1] = a[j];
+            j--;
+        }
+        a[j + 1] = value;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void minmax_avx2(__m256i* a, __m256i* b) {
+    __m256i low = _mm256_min_epi32(*a, *b);
+    *b = _mm256_max_epi32(*a, *b);
+    *a = low;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i clean_avx2(__m256i v) {
+    //sorts a bitonic vector, compare-exchange at distances 4, 2 and 1
+    __m256i p = _mm256_permute2x128_si256(v, v, 1);
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xF0);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xCC);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xAA);
+}
+
+__attribute__((target("avx2")))
+static inline void merge_avx2(__m256i* r, int m) {
+    //r[0 .. m - 1] and r[m .. 2m - 1] are sorted runs: the second one reversed makes the whole
+    //sequence bitonic, a half-cleaner splits it in two bitonic halves that are sorted separately
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    for (int i = 0; i < m / 2; i++) {
+        __m256i t = r[m + i];
+        r[m + i] = _mm256_permutevar8x32_epi32(r[2 * m - 1 - i], reverse);
+        r[2 * m - 1 - i] = _mm256_permutevar8x32_epi32(t, reverse);
+    }
+    if (m == 1)
+        r[1] = _mm256_permutevar8x32_epi32(r[1], reverse);
+    for (int i = 0; i < m; i++)
+        minmax_avx2(&r[i], &r[m + i]);
+    for (int half = 0; half < 2 * m; half += m) {
+        for (int d = m / 2; d > 0; d /= 2)
+            for (int i = 0; i < m; i++)
+                if ((i & d) == 0)
+                    minmax_avx2(&r[half + i], &r[half + i + d]);
+        for (int i = 0; i < m; i++)
+            r[half + i] = clean_avx2(r[half + i]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void leaf_avx2(int* a) {
+    //bitonic sort of 64 ints in 8 registers: a sorting network down the columns, a transposition
+    //to 8 sorted runs in the registers, and three levels of in-register bitonic merges
+    static const int network[19][2] = {
+        { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, { 0, 1 }, { 2, 3 },
+        { 4, 5 }, { 6, 7 }, { 2, 4 }, { 3, 5 }, { 1, 4 }, { 3, 6 }, { 1, 2 }, { 3, 4 }, { 5, 6 }
+    };
+    __m256i r[8];
+    for (int i = 0; i < 8; i++)
+        r[i] = _mm256_loadu_si256((const __m256i*)(a + 8 * i));
+    for (int c = 0; c < 19; c++)
+        minmax_avx2(&r[network[c][0]], &r[network[c][1]]);
+
+    __m256i t[8], u[8];
+    for (int i = 0; i < 8; i += 2) {
+        t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (int i = 0; i < 8; i += 4) {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (int i = 0; i < 4; i++) {
+        r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+
+    for (int m = 1; m < 8; m *= 2)
+        for (int i = 0; i < 8; i += 2 * m)
+            merge_avx2(r + i, m);
+    for (int i = 0; i < 8; i++)
+        _mm256_storeu_si256((__m256i*)(a + 8 * i), r[i]);
+}
+
+typedef void (*t_leaf_kernel_sort)(int* a);
+static t_leaf_kernel_sort leaf_kernel = leaf_insertion;
+
+int select_kernel_sort(int simd) {
+    //0 - best supported, 1 - insertion sort, 2 - AVX2 sorting network (lowered to what the CPU supports)
+    __builtin_cpu_init();
+    int best = __builtin_cpu_supports("avx2") ? 2 : 1;
+    if (simd == 0 || simd > best)
+        simd = best;
+    switch (simd) {
+        case 2: leaf_kernel = leaf_avx2; sort_kernel = "AVX2 bitonic network"; break;
+        default: leaf_kernel = leaf_insertion; sort_kernel = "insertion sort"; simd = 1; break;
+    }
+    return simd;
+}
+
+static void sort_leaf(int* a, int size, int force) {
+    //a full block goes through the kernel, the remaining elements are inserted one by one
+    int sorted = 1;
+    if (size == SORT_LEAF) {
+        leaf_kernel(a);
+        sorted = SORT_LEAF;
+    }
+    for (int i = sorted; i < size + force; i++) {
+        int value = a[i];
+        int j = i - 1;
+        while (j >= 0 && a[j] > value) {
+            a[j + 1] = a[j];
+            j--;
+        }
+        a[j + 1] = value;
+    }
+}
+
+static int* level_output(int* array, int level) {
+    //the last level writes the array, the levels before alternate - all of them in the ping-pong
+    //mode, otherwise only the split levels, and the level below them writes where they read from
+    if (!sort_pingpong && level < split_level - 1)
+        return array;
+    if (!sort_pingpong && level == split_level - 1)
+        return level_output(array, split_level) == array ? pingpong_buffer : array;
+    if ((sort_levels - level) % 2 == 0)
+        return array;
+    return pingpong_buffer;
+}
+
+static int* scratch_sort(long size) {
+    t_sort_arena* arena = &sort_arenas[omp_get_thread_num()];
+    if (arena->capacity < size) {
+        //grown to twice the size, the packets double from level to level
+        free(arena->data);
+        arena->capacity = 2 * size;
+        arena->data = (int*)malloc(sizeof(int) * arena->capacity);
+        if (arena->data == NULL) {
+            perror("Memory allocation failed (arena)");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return arena->data;
+}
+
+long generate_new_input_sort(t_input_sort* input, int* array) { // returned value: how many items generated
+
+	static int level = SORT_LEAF_LEVEL; //level of recursion for example level 7 has 2^7=128 elements in input, the leaf level 2^6
+    static int howmanygenerated = 0;
+	static int done_phases_this_level = 0; //only one layer of recursion is done at a time
+	static int done_parts_this_phase = 0;
+    if (sort_algorithm == ALGO_RADIX_SORT)
+        return generate_radix_sort(input, array, pingpong_buffer);
+    int pow = 1 << level;
+    int parts = level == SORT_LEAF_LEVEL ? 1 : parts_sort(level, sort_threads); //sub-merges of every merge
+	int total_phases_this_level = arraySize / pow; //max number of phases in this level
+	if (total_phases_this_level == 0) //shorter than a leaf block, one leaf packet
+		total_phases_this_level = 1;
+	int forced = arraySize >= pow ? arraySize - pow * total_phases_this_level : 0; //how many elements are left to be sorted and has to be added to the last input
+
+
+    int* src = level == SORT_LEAF_LEVEL ? array : level_output(array, level - 1);
+    int* dst = level_output(array, level);
+    int counter = 0;
+	//maximum number of elements to be generated this time
+    int max = BUFFERSIZE;
+    if (BUFFERSIZE > (CHUNKCOUNT - howmanygenerated))
+        max = CHUNKCOUNT - howmanygenerated;
+
+    for (counter = 0;counter < max;counter++) {
+		//this is for the last phase of the last level
+        if (pow >= arraySize) {
+            input[counter].left = array;
+            input[counter].middle = arraySize / 2 - 1;
+            input[counter].size = arraySize;
+            input[counter].src = src;
+            input[counter].dst = dst;
+        }
+        //standard case
+        else {
+            input[counter].left = &(array[(1 << level) * done_phases_this_level]);
+            input[counter].middle = (1 << (level - 1)) - 1;
+            input[counter].size = (1 << level);
+            input[counter].src = src + (1 << level) * done_phases_this_level;
+            input[counter].dst = dst + (1 << level) * done_phases_this_level;
+        }
+        input[counter].leaf = level == SORT_LEAF_LEVEL;
+        input[counter].kind = PACKET_MERGE_SORT;
+        input[counter].pass = 0;
+        input[counter].slice = 0;
+        input[counter].part = done_parts_this_phase;
+        input[counter].parts = parts;
+        //if there is remaining elements, add them to the last input (to every part of it)
+        input[counter].force = done_phases_this_level == total_phases_this_level - 1 ? forced : 0;
+        howmanygenerated++;
+        if (++done_parts_this_phase == parts) {
+            done_parts_this_phase = 0;
+            done_phases_this_level++;
+        }
+        #ifdef _DEBUG
+            FILE* fp = fopen("debug.txt", "a");
+            fprintf(fp, "left: %d, middle: %d, size: %d, force: %d, part: %d of %d, level: %d, done_phases_this_level: %d, total_phases_this_level: %d, pow: %d, forced: %d\n", (int)(input[counter].left - array), input[counter].middle, input[counter].size, input[counter].force, input[counter].part, parts, level, done_phases_this_level, total_phases_this_level, pow, forced);
+            fclose(fp);
+        #endif
+        if (done_phases_this_level == total_phases_this_level) {
+            counter++;
+            break;
+        }
+    }
+	//if level is done, go to the next level
+    if (done_phases_this_level >= total_phases_this_level) {
+        level++;
+        done_phases_this_level = 0;
+
+    }
+	
+    return counter;
+
+}
+
+int owner_sort(const t_input_sort* packet, const int* array, int threads) {
+    //contiguous parts of the array, the merges inside a part stay on the thread that sorted its runs,
+    //a sub-merge goes by the start of its output
+    long long position = (packet->left - array) + (long long)(packet->size + packet->force) * packet->part / packet->parts;
+    int owner = (int)(position * threads / arraySize);
+    return owner < threads ? owner : threads - 1;
+}
+
+static void merge_runs(const int* a, long na, const int* b, long nb, int* out) {
+    long i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            out[k++] = a[i++];
+        }
+        else {
+            out[k++] = b[j++];
+        }
+    }
+	//copying the rest of the elements
+    while (i < na) out[k++] = a[i++];
+    while (j < nb) out[k++] = b[j++];
+}
+
+static void merge3(const int* a, long na, const int* b, long nb, const int* c, long nc, int* out) {
+    long i = 0, j = 0, t = 0, k = 0;
+    while (i < na && j < nb && t < nc) {
+        if (a[i] < b[j]) {
+            if (a[i] < c[t]) out[k++] = a[i++];
+            else out[k++] = c[t++];
+        }
+        else {
+            if (b[j] < c[t]) out[k++] = b[j++];
+            else out[k++] = c[t++];
+        }
+    }
+    //two runs left at most
+    if (t == nc)
+        merge_runs(a + i, na - i, b + j, nb - j, out + k);
+    else if (j == nb)
+        merge_runs(a + i, na - i, c + t, nc - t, out + k);
+    else
+        merge_runs(b + j, nb - j, c + t, nc - t, out + k);
+}
+
+static long co_rank(long k, const int* a, long na, const int* b, long nb) {
+    //merge path: the number of elements of a among the first k of the merge of a and b
+    long low = k > nb ? k - nb : 0, high = k < na ? k : na;
+    while (low < high) {
+        long i = (low + high) / 2;
+        if (b[k - i - 1] < a[i])
+            high = i;
+        else
+            low = i + 1;
+    }
+    return low;
+}
+
+static int merged_at(long x, const int* a, long na, const int* b, long nb) {
+    //element x of the merge of a and b, without merging
+    long i = co_rank(x + 1, a, na, b, nb), j = x + 1 - i;
+    if (i == 0)
+        return b[j - 1];
+    if (j == 0)
+        return a[i - 1];
+    return a[i - 1] > b[j - 1] ? a[i - 1] : b[j - 1];
+}
+
+static void co_rank3(long k, const int* a, long na, const int* b, long nb, const int* c, long nc, long* i, long* j, long* t) {
+    //the first k elements of the merge of three runs: the merge path of c and the (virtual) merge of
+    //a and b, then the merge path inside a and b
+    long x = k;
+    if (nc > 0) {
+        long low = k > nc ? k - nc : 0, high = k < na + nb ? k : na + nb;
+        while (low < high) {
+            long middle = (low + high) / 2;
+            if (c[k - middle - 1] < merged_at(middle, a, na, b, nb))
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        x = low;
+    }
+    *i = co_rank(x, a, na, b, nb);
+    *j = x - *i;
+    *t = k - x;
+}
+
+void process_sort(t_input_sort* data) {
+
+    if (data->kind != PACKET_MERGE_SORT) {
+        process_radix_sort(data);
+        return;
+    }
+
+    if (data->leaf) {
+        if (data->dst != data->src)
+            memcpy(data->dst, data->src, sizeof(int) * (data->size + data->force));
+        sort_leaf(data->dst, data->size, data->force);
+        return;
+    }
+
+    //the two runs and the forced elements of the last packet of a level, all in one pass
+    const int* a = data->src;
+    const int* b = data->src + data->middle + 1;
+    const int* c = data->src + data->size;
+    long na = data->middle + 1, nb = data->size - na, nc = data->force;
+    long total = data->size + data->force;
+
+    if (data->parts > 1) {
+        //sub-merge of the output positions begin .. end - 1, never in place
+        long begin = total * data->part / data->parts, end = total * (data->part + 1) / data->parts;
+        long i0, j0, t0, i1, j1, t1;
+        co_rank3(begin, a, na, b, nb, c, nc, &i0, &j0, &t0);
+        co_rank3(end, a, na, b, nb, c, nc, &i1, &j1, &t1);
+        merge3(a + i0, i1 - i0, b + j0, j1 - j0, c + t0, t1 - t0, data->dst + begin);
+        return;
+    }
+
+    //in place - merged in the scratch arena and copied back
+    int* out = data->dst == data->src ? scratch_sort(total) : data->dst;
+    merge3(a, na, b, nb, c, nc, out);
+
+	//copying the sorted elements back
+    if (out != data->dst)
+        memcpy(data->dst, out, sizeof(int) * total);
+}
@@ -1,23 +1,60 @@
-#ifndef MERGESORT_H
-#define MERGESORT_H
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <omp.h>
-#include <math.h>
-
-extern int BUFFERSIZE;
-extern int arraySize;
-extern int CHUNKCOUNT;
-
-typedef struct {
-	int* left; // pointer to the left part of the input
-	int middle; // index of the middle element (first of the right part)
-	int size; // size of the input to sort
-    int force; //number of extra elements to consider in merge sort when the array size is not a power of two.
-} t_input_sort;
-
-long generate_new_input_sort(t_input_sort* input, int* array);
-void process_sort(t_input_sort* data);
-
+#ifndef MERGESORT_H
+#define MERGESORT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <math.h>
+
+extern int BUFFERSIZE;
+extern int arraySize;
+extern int CHUNKCOUNT;
+extern const char* sort_kernel; //Instruction set of the leaf sort kernel in use
+
+//The first level sorts leaf blocks of 2^SORT_LEAF_LEVEL elements in one packet each (the last one
+//with the remaining elements, a shorter array in one packet), the merge levels start above them
+#define SORT_LEAF_LEVEL 6
+#define SORT_LEAF (1 << SORT_LEAF_LEVEL)
+
+typedef struct {
+	int* left; // pointer to the left part of the input
+	int middle; // index of the middle element (first of the right part)
+	int size; // size of the input to sort
+    int force; //number of extra elements to consider in merge sort when the array size is not a power of two.
+	int* src; // sorted runs of the packet, the array or the ping-pong buffer at the offset of left
+	int* dst; // merged output, src - merged in the scratch arena of the thread and copied back
+	int leaf; // 1 - no runs yet, the size + force elements are sorted by the leaf kernel
+	int part; // sub-merge part of parts of equal output size, split by merge path, parts 1 - the whole merge
+	int parts;
+	int kind; // PACKET_..._SORT
+	int pass; // radix sort: digit of the pass
+	int slice; // radix sort: slice of the array, or chunk of digits of a prefix packet
+} t_input_sort;
+
+//Packet kinds
+#define PACKET_MERGE_SORT 0 // leaf block or merge
+#define PACKET_HIST_SORT 1 // radix sort: digit histogram of a slice
+#define PACKET_PREFIX_SORT 2 // radix sort: offsets of a chunk of digits in every slice
+#define PACKET_SCATTER_SORT 3 // radix sort: keys of a slice to their places in the other buffer
+#define PACKET_COPY_SORT 4 // radix sort: slice copied to the other buffer, the pass does not move keys
+
+//Sorting algorithms
+#define ALGO_MERGE_SORT 0
+#define ALGO_RADIX_SORT 1
+extern int sort_algorithm;
+
+//Merges go through a scratch arena per thread, allocated once and grown to the largest packet,
+//or with pingpong directly from one level's buffer to the other's, the array and a second buffer
+//of arraySize ints take turns. The parity of the number of levels decides whether the leaf level
+//writes the array or the buffer, so the last level always ends in the array.
+//Levels of fewer merges than threads split every merge in parts_sort sub-merges (merge path), these
+//write into the other buffer in both modes.
+void prepare_sort(int threads, int pingpong, int algorithm);
+void finish_sort(void);
+int select_kernel_sort(int simd);
+int parts_sort(int level, int threads);
+long generate_new_input_sort(t_input_sort* input, int* array);
+void process_sort(t_input_sort* data);
+int owner_sort(const t_input_sort* packet, const int* array, int threads);
+
 #endif
\ No newline at end of file
@@ -1,18 +1,25 @@
-#ifndef MERGESORTMasterSlave_H
-#define MERGESORTMasterSlave_H
-#include "MergeSort.h"
-
-typedef struct {
-	int size;
-	int model;
-	int thread_num;
-	int buffer_size;
-}SettingsSort;
-
-int dynamicForMergeSort(int* array, SettingsSort settings);
-int taskingMergeSort(int* array, SettingsSort settings);
-int integratedMasterMergeSort(int* array, SettingsSort settings);
-void print_progress(int percent);
-long long count_chunks(int size);
-
+#ifndef MERGESORTMasterSlave_H
+#define MERGESORTMasterSlave_H
+#include "MergeSort.h"
+#include "MergeSortRadix.h"
+#include "Affinity.h"
+
+typedef struct {
+	int size;
+	int model;
+	int thread_num;
+	int buffer_size;
+	int affinity; // 1 - owner-computes queues in the dynamic model, a part of the array stays with one thread
+	int pingpong; // 1 - the levels merge between the array and a second buffer instead of through scratch arenas
+	int simd; // leaf sort kernel, 0 - best supported, 1 - insertion sort, 2 - AVX2 sorting network
+	int algorithm; // ALGO_MERGE_SORT or ALGO_RADIX_SORT
+	int report; // 1 - print working time and energy
+}SettingsSort;
+
+int dynamicForMergeSort(int* array, SettingsSort settings);
+int taskingMergeSort(int* array, SettingsSort settings);
+int integratedMasterMergeSort(int* array, SettingsSort settings);
+void print_progress(int percent);
+long long count_chunks(int size, int threads);
+
 #endif
\ No newline at end of file
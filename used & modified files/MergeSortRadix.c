@@ -0,0 +1,189 @@
+#include "MergeSortRadix.h"
+#include <string.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+static int radix_slices = 0;
+static int radix_slice_size = 0;
+static int* radix_histogram = NULL; // slices x digits, counts and then offsets inside the digit
+static long radix_total[RADIX_DIGITS_SORT]; // keys of every digit, from the prefix packets
+static long radix_base[RADIX_DIGITS_SORT]; // first position of every digit, set by the generator
+
+//a whole 64 byte line of dst written with non-temporal stores, so it bypasses the cache and
+//fills a write-combining buffer at once instead of reading the line in first
+__attribute__((target("avx2")))
+static void stream_line_avx2(int* out, const int* line) {
+    _mm256_stream_si256((__m256i*)out, _mm256_load_si256((const __m256i*)line));
+    _mm256_stream_si256((__m256i*)(out + 8), _mm256_load_si256((const __m256i*)(line + 8)));
+}
+
+static void stream_line_sse2(int* out, const int* line) {
+    for (int k = 0; k < 16; k += 4)
+        _mm_stream_si128((__m128i*)(out + k), _mm_load_si128((const __m128i*)(line + k)));
+}
+
+static void (*stream_line)(int* out, const int* line) = stream_line_sse2;
+
+void prepare_radix_sort(int threads) {
+    //slices of RADIX_SLICE_SORT elements, at least four per thread while they hold 1024 elements
+    long slices = ((long)arraySize + RADIX_SLICE_SORT - 1) / RADIX_SLICE_SORT;
+    if (slices < 4L * threads)
+        slices = 4L * threads < ((long)arraySize + 1023) / 1024 ? 4L * threads : ((long)arraySize + 1023) / 1024;
+    if (slices < 1)
+        slices = 1;
+    radix_slices = (int)slices;
+    radix_slice_size = (int)(((long)arraySize + slices - 1) / slices);
+    radix_histogram = (int*)malloc(sizeof(int) * RADIX_DIGITS_SORT * radix_slices);
+    if (radix_histogram == NULL) {
+        perror("Memory allocation failed (histograms)");
+        exit(EXIT_FAILURE);
+    }
+    __builtin_cpu_init();
+    stream_line = __builtin_cpu_supports("avx2") ? stream_line_avx2 : stream_line_sse2;
+}
+
+void free_radix_sort(void) {
+    free(radix_histogram);
+    radix_histogram = NULL;
+}
+
+long long count_radix_sort(void) {
+    //histogram, prefix and scatter packets of every pass, skipped passes included
+    if (arraySize == 0)
+        return 0;
+    return (long long)RADIX_PASSES_SORT * (2 * radix_slices + RADIX_DIGITS_SORT / RADIX_CHUNK_SORT);
+}
+
+static inline int digit_sort(int key, int pass) {
+    return (int)((((unsigned int)key ^ 0x80000000u) >> (RADIX_BITS_SORT * pass)) & (RADIX_DIGITS_SORT - 1));
+}
+
+long generate_radix_sort(t_input_sort* input, int* array, int* buffer) { // returned value: how many items generated
+
+    static int pass = 0;
+    static int phase = PACKET_HIST_SORT;
+    static int done = 0; // packets of the phase so far
+    static int skipped = 0; // the pass does not move the keys, its scatter packets do nothing
+    int total = phase == PACKET_PREFIX_SORT ? RADIX_DIGITS_SORT / RADIX_CHUNK_SORT : radix_slices;
+    //passes alternate, the last one writes the array
+    int* src = (RADIX_PASSES_SORT - pass) % 2 == 0 ? array : buffer;
+    int* dst = src == array ? buffer : array;
+
+    if (pass == RADIX_PASSES_SORT || arraySize == 0)
+        return 0;
+    if (phase == PACKET_SCATTER_SORT && done == 0) {
+        //exclusive scan of the digit totals, the columns were summed by the prefix packets
+        long position = 0;
+        skipped = 0;
+        for (int d = 0; d < RADIX_DIGITS_SORT; d++) {
+            radix_base[d] = position;
+            position += radix_total[d];
+            if (radix_total[d] == arraySize)
+                skipped = 1;
+        }
+    }
+
+    long counter = 0;
+    while (counter < BUFFERSIZE && done < total) {
+        int begin = phase == PACKET_PREFIX_SORT ? 0 : done * radix_slice_size;
+        int size = phase == PACKET_PREFIX_SORT ? RADIX_CHUNK_SORT : radix_slice_size;
+        if (begin + size > arraySize && phase != PACKET_PREFIX_SORT)
+            size = begin < arraySize ? arraySize - begin : 0;
+        input[counter].left = array + begin;
+        input[counter].middle = 0;
+        input[counter].size = size;
+        input[counter].force = 0;
+        input[counter].src = src + begin;
+        input[counter].leaf = 0;
+        input[counter].part = 0;
+        input[counter].parts = 1;
+        input[counter].kind = phase == PACKET_SCATTER_SORT && skipped ? PACKET_COPY_SORT : phase;
+        //a scatter packet writes anywhere in the other buffer, a copy packet to its own slice
+        input[counter].dst = input[counter].kind == PACKET_COPY_SORT ? dst + begin : dst;
+        input[counter].pass = pass;
+        input[counter].slice = done;
+        counter++;
+        done++;
+    }
+    //every phase is a batch of its own
+    if (done == total) {
+        done = 0;
+        if (phase == PACKET_SCATTER_SORT) {
+            phase = PACKET_HIST_SORT;
+            pass++;
+        }
+        else {
+            phase++;
+        }
+    }
+    return counter;
+}
+
+static void histogram_slice(const t_input_sort* data) {
+    int* count = radix_histogram + (size_t)data->slice * RADIX_DIGITS_SORT;
+    memset(count, 0, sizeof(int) * RADIX_DIGITS_SORT);
+    for (int i = 0; i < data->size; i++)
+        count[digit_sort(data->src[i], data->pass)]++;
+}
+
+static void prefix_digits(const t_input_sort* data) {
+    //down the columns of the digits slice .. slice + RADIX_CHUNK_SORT - 1: offsets inside the digit
+    int first = data->slice * RADIX_CHUNK_SORT;
+    for (int d = first; d < first + RADIX_CHUNK_SORT; d++) {
+        long running = 0;
+        for (int s = 0; s < radix_slices; s++) {
+            int* count = radix_histogram + (size_t)s * RADIX_DIGITS_SORT + d;
+            int value = *count;
+            *count = (int)running;
+            running += value;
+        }
+        radix_total[d] = running;
+    }
+}
+
+static void scatter_slice(const t_input_sort* data) {
+    //keys are collected in a cache line per digit. The first flush of a digit is cut short so
+    //that it ends on a 64 byte boundary of dst, after which every flush is a whole aligned line
+    //written with streaming stores; only the head and the tail of a digit use plain stores
+    enum { LINE = 64 / sizeof(int) };
+    int line[RADIX_DIGITS_SORT][LINE] __attribute__((aligned(64)));
+    int fill[RADIX_DIGITS_SORT];
+    int limit[RADIX_DIGITS_SORT];
+    long next[RADIX_DIGITS_SORT];
+    const int* offset = radix_histogram + (size_t)data->slice * RADIX_DIGITS_SORT;
+    for (int d = 0; d < RADIX_DIGITS_SORT; d++) {
+        fill[d] = 0;
+        next[d] = radix_base[d] + offset[d];
+        limit[d] = LINE - (int)(((uintptr_t)(data->dst + next[d]) / sizeof(int)) % LINE);
+    }
+    for (int i = 0; i < data->size; i++) {
+        int key = data->src[i];
+        int d = digit_sort(key, data->pass);
+        line[d][fill[d]++] = key;
+        if (fill[d] == limit[d]) {
+            if (limit[d] == LINE)
+                stream_line(data->dst + next[d], line[d]);
+            else
+                memcpy(data->dst + next[d], line[d], sizeof(int) * limit[d]);
+            next[d] += limit[d];
+            fill[d] = 0;
+            limit[d] = LINE;
+        }
+    }
+    for (int d = 0; d < RADIX_DIGITS_SORT; d++)
+        if (fill[d] > 0)
+            memcpy(data->dst + next[d], line[d], sizeof(int) * fill[d]);
+    //the streaming stores are weakly ordered, they must be visible before the packet is done
+    _mm_sfence();
+}
+
+void process_radix_sort(t_input_sort* data) {
+    switch (data->kind) {
+        case PACKET_HIST_SORT: histogram_slice(data); break;
+        case PACKET_PREFIX_SORT: prefix_digits(data); break;
+        case PACKET_SCATTER_SORT: scatter_slice(data); break;
+        //the keys stay in their order, only the buffer changes
+        case PACKET_COPY_SORT: memcpy(data->dst, data->src, sizeof(int) * data->size); break;
+        default: break;
+    }
+}
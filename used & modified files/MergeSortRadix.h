@@ -0,0 +1,24 @@
+#ifndef MERGESORTRADIX_H
+#define MERGESORTRADIX_H
+#include "MergeSort.h"
+
+//LSD radix sort of the int keys (-algo radix), RADIX_PASSES_SORT passes of 8 bit digits from the
+//lowest one, the top digit with the sign bit flipped. Every pass is three batches of packets:
+//histograms of the digits of every slice of the array, prefix sums down every digit column of the
+//histograms (chunks of digits), and the stable scatter of every slice through write-combining
+//buffers of a cache line per digit, whose whole aligned lines go out with streaming stores. The
+//passes alternate between the array and the second buffer, an even number of passes ends in the
+//array; a pass whose digit is the same for all keys is skipped.
+#define RADIX_BITS_SORT 8
+#define RADIX_DIGITS_SORT (1 << RADIX_BITS_SORT)
+#define RADIX_PASSES_SORT 4
+#define RADIX_SLICE_SORT 65536 // elements of a slice, smaller for short arrays so every thread gets slices
+#define RADIX_CHUNK_SORT 32 // digits of a prefix packet
+
+void prepare_radix_sort(int threads);
+void free_radix_sort(void);
+long long count_radix_sort(void);
+long generate_radix_sort(t_input_sort* input, int* array, int* buffer);
+void process_radix_sort(t_input_sort* data);
+
+#endif
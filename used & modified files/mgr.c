@@ -1,512 +1,1225 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <omp.h>
-#include <math.h>
-#include <string.h>
-#include "MandelbrotMasterSlave.h"
-#include "MergeSortMasterSlave.h"
-#include "MatrixDeterminantMasterSlave.h"
-
-
-//To run the program correctly there is only needed to add the first argument
-// - Mb for Mandelbrot
-// - Mx for Matrix Determinant
-// - St for Merge Sort
-
-//For getting help with arguments add -help or -h as the second argument
-//Example: ./mgr Mb -help
-//All arguments are optional, but the first one is required
-//All arguments have their default values, so if you want to run the program with default values, just add the first argument
-
-
-
-int* g_array = NULL;
-//Mandelbrot
-void runMandelbrot(int argc, char** argv);
-void displayMandelbrotSettings(SettingsMandelbrot settings);
-void displayMandelbrotHelp();
-
-//Matrix
-void runMatrixDeterminant(int argc, char** argv);
-void displayMatrixSettings(SettingsMatrix settings);
-void displayMatrixHelp();
-double** generateMatrix(int size);
-
-// Merge Sort
-void runMergeSort(int argc, char** argv);
-void displayMergeSortSettings(SettingsSort settings);
-void displayMergeSortHelp();
-int* generateArray(int size);
-
-int main(int argc, char** argv) {
-
-#ifdef _DEBUG
-	FILE* fp = fopen("debug.txt", "w");
-	fclose(fp);
-#endif
-   
-	if (argc > 1) {
-		if (!strcmp(argv[1], "Mb")) {
-			if (argc > 2 && (!strcmp(argv[2], "-help") || !strcmp(argv[2], "-h"))) {
-				// Display help for Mandelbrot arguments
-				displayMandelbrotHelp();
-			}
-			else {
-				//Run Mandelbrot calculation with remaining arguments
-				runMandelbrot(argc - 2, argv + 2);
-			}
-		}
-		else if (!strcmp(argv[1], "Mx")) {
-			if (argc > 2 && (!strcmp(argv[2], "-help") || !strcmp(argv[2], "-h"))) {
-				// Display help for Matrix arguments
-				displayMatrixHelp();
-			}
-			else {
-				//Run Matrix Determinant calculation with remaining arguments
-				runMatrixDeterminant(argc - 2, argv + 2);
-			}
-		}
-		else if (!strcmp(argv[1], "St")) {
-			if (argc > 2 && (!strcmp(argv[2], "-help") || !strcmp(argv[2], "-h"))) {
-				//Display help for Merge Sort arguments
-				displayMergeSortHelp();
-			}
-			else {
-				//Run Merge Sort calculation with remaining arguments
-				runMergeSort(argc - 2, argv + 2);
-			}
-		}
-		else {
-			printf("Invalid first argument. Use 'Mb' for Mandelbrot, 'Mx' for Matrix Determinant, or 'St' for Merge Sort.\n");
-		}
-	}
-	else {
-		printf("No arguments provided. Use 'Mb' for Mandelbrot, 'Mx' for Matrix Determinant, or 'St' for Merge Sort.\n");
-	}
-		
-    return 0;
-}
-//Mandelbrot
-void runMandelbrot(int argc, char** argv) {
-	SettingsMandelbrot settings;
-	settings.re_min = -2.0;
-	settings.re_max = 1.0;
-	settings.im_min = -1.5;
-	settings.im_max = 1.5;
-	settings.max_iterations = 1000;
-	settings.image_width = 1920;
-	settings.image_height = 1080;
-	settings.block_size = 8;
-	settings.thread_num = 4;
-	settings.buffer_size = 512;
-	settings.model = 0; // 0 - dynamic, 1 - tasking, 2 - integrated
-
-	// Parse command line arguments
-	for (int i = 0; i < argc; i+=2) {
-		if (!strcmp(argv[i], "-rmin")) {
-			settings.re_min = atof(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-rmax")) {
-			settings.re_max = atof(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-imin")) {
-			settings.im_min = atof(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-imax")) {
-			settings.im_max = atof(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-w")) {
-			settings.image_width = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-h")) {
-			settings.image_height = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-b")) {
-			settings.block_size = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-t")) {
-			settings.thread_num = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-it")) {
-			settings.max_iterations = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-model")) {
-			settings.model = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-bs")) {
-			settings.buffer_size = atoi(argv[i + 1]);
-		}
-		else {
-			printf("Invalid argument: %s\n", argv[i]);
-			exit(0);
-		}
-	}
-	// Display the settings (once)
-	#ifdef _DEBUG
-		displayMandelbrotSettings(settings);
-	#endif
-	// Allocate memory for the result buffer
-		int** result_buffer = malloc(settings.image_height * sizeof(int*));
-	if (result_buffer == NULL) {
-		perror("Memory allocation failed (image_height)");
-		exit(EXIT_FAILURE);
-	}
-	for (int i = 0; i < settings.image_height; ++i) {
-		result_buffer[i] = calloc(settings.image_width, sizeof(int));
-		if (result_buffer[i] == NULL) {
-			perror("Memory allocation failed (image_width)");
-			exit(EXIT_FAILURE);
-		}
-	}
-	// Run Mandelbrot calculation based on the selected model
-	switch (settings.model) {
-		case 0: dynamicForMandelbrot(result_buffer, settings); break;
-		case 1: taskingMandelbrot(result_buffer, settings); break;
-		case 2: integratedMasterMandelbrot(result_buffer, settings); break;
-		default: printf("Bad model\n"); break;
-	}
-	// Save the result as a PPM file
-	#ifdef _DEBUG
-		//save_result_as_ppm("mandelbrot.ppm", result_buffer);
-	#endif
-	// Free the result buffer
-	for (int i = 0; i < settings.image_height; i++) {
-		free(result_buffer[i]);
-	}
-	free(result_buffer);
-	#ifdef _DEBUG
-		print_progress(100);
-		printf("\nMandelbrot set calculation completed. Result saved to mandelbrot.ppm\n");
-	#endif
-}
-void displayMandelbrotSettings(SettingsMandelbrot settings) {
-	const char* model_name;
-
-	switch (settings.model) {
-	case 0: model_name = "dynamic"; break;
-	case 1: model_name = "tasking"; break;
-	case 2: model_name = "integrated"; break;
-	default: model_name = "unknown"; break;
-	}
-
-	printf("----- Settings -----\n");
-	printf("Resolution      : %d x %d\n", settings.image_width, settings.image_height);
-	printf("Complex range   : re = [%.2f, %.2f], im = [%.2f, %.2f]\n",
-		settings.re_min, settings.re_max, settings.im_min, settings.im_max);
-	printf("Max iterations  : %d\n", settings.max_iterations);
-	printf("Block size      : %d\n", settings.block_size);
-	printf("Thread count    : %d\n", settings.thread_num);
-	printf("Buffer size     : %d\n", settings.buffer_size);
-	printf("Parallel model  : %s\n", model_name);
-	printf("--------------------\n");
-}
-void displayMandelbrotHelp() {
-	printf("Usage: Mandelbrot [options]\n");
-	printf("Options:\n");
-	printf("  -rmin <value>   Set the minimum real part (default: -2.0)\n");
-	printf("  -rmax <value>   Set the maximum real part (default: 1.0)\n");
-	printf("  -imin <value>   Set the minimum imaginary part (default: -1.5)\n");
-	printf("  -imax <value>   Set the maximum imaginary part (default: 1.5)\n");
-	printf("  -w <value>      Set the image width (default: 1920)\n");
-	printf("  -h <value>      Set the image height (default: 1080)\n");
-	printf("  -b <value>      Set the block size (default: 8)\n");
-	printf("  -t <value>      Set the number of threads (default: 4)\n");
-	printf("  -it <value>      Set the maximum iterations (default: 1000)\n");
-	printf("  -bs <value>     Set the buffer size value (default: 512)\n");
-	printf("  -model <value>  Set the parallel model (0: dynamic, 1: tasking, 2: integrated, default: 0)\n");
-	printf("  -help           Display this help message\n");
-}
-
-//Matrix
-void runMatrixDeterminant(int argc, char** argv) {
-	SettingsMatrix settings;
-	settings.size = 10;
-	settings.vandermonde = 1;
-	settings.model = 0; // 0 - dynamic, 1 - tasking, 2 - integrated
-	settings.prefab = 0; // 1 - 4x4, 2 - 10x10
-	settings.thread_num = 4;
-	settings.buffer_size = 512;
-
-	double** matrix = NULL;
-	
-	#ifdef _DEBUG
-		long double correctDet = 0;
-		long double det = 0;
-		double rel_error = 0;
-	#endif
-	// Parse command line arguments
-	for (int i = 0; i < argc; i += 2) {
-		if (!strcmp(argv[i], "-size")) {
-			settings.size = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-vm")) {
-			if (settings.prefab == 0) {
-				settings.vandermonde = atoi(argv[i + 1]);
-			}
-			else {
-				printf("Vandermonde option is not available for prefab matrices.\n");
-				exit(0);
-			}
-		}
-		else if (!strcmp(argv[i], "-model")) {
-			settings.model = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-prefab")) {
-			if (settings.vandermonde == 1) {
-				printf("Prefab option is not available for Vandermonde matrices.\n");
-				exit(0);
-			}
-			else {
-				settings.prefab = atoi(argv[i + 1]);
-			}		
-		}
-		else if (!strcmp(argv[i], "-t")) {
-			settings.thread_num = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-bs")) {
-			settings.buffer_size = atoi(argv[i + 1]);
-		}
-		else {
-			printf("Invalid argument: %s\n", argv[i]);
-			exit(0);
-		}
-	}
-	//Display the settings (once)
-	#ifdef _DEBUG
-		displayMatrixSettings(settings);
-	#endif
-	//Generate matrix to calculate and instantly determine the correct determinant
-	//if the vandermonde flag is set (default)
-	if (settings.vandermonde) {
-		matrix = generateVandermondeMatrix(settings.size);
-		#ifdef _DEBUG
-			correctDet = vandermondeDeterminant(settings.size);
-		#endif
-	}
-	else {
-		//Save from first tests 
-		if (settings.prefab == 1) {
-			settings.size = 4;
-			matrix = generateMatrix(settings.size);
-			#ifdef _DEBUG
-				correctDet = -89.0;
-			#endif
-
-			matrix[0][0] = 2.0;  matrix[0][1] = 1.0;  matrix[0][2] = -1.0; matrix[0][3] = 2.0;
-			matrix[1][0] = -3.0; matrix[1][1] = -1.0; matrix[1][2] = 2.0;  matrix[1][3] = -11.0;
-			matrix[2][0] = -2.0; matrix[2][1] = 1.0;  matrix[2][2] = 2.0;  matrix[2][3] = -3.0;
-			matrix[3][0] = 1.0;  matrix[3][1] = 2.0;  matrix[3][2] = 3.0;  matrix[3][3] = 4.0;
-		}
-		else if (settings.prefab == 2) {
-			settings.size = 10;
-			matrix = generateMatrix(settings.size);
-			#ifdef _DEBUG
-				correctDet = -4683298;
-			#endif
-			
-
-			matrix[0][0] = 5.0;  matrix[0][1] = 2.0;  matrix[0][2] = 1.0;  matrix[0][3] = 4.0;  matrix[0][4] = 3.0;
-			matrix[0][5] = 7.0;  matrix[0][6] = 2.0;  matrix[0][7] = 8.0;  matrix[0][8] = 1.0;  matrix[0][9] = 3.0;
-			matrix[1][0] = 2.0;  matrix[1][1] = 6.0;  matrix[1][2] = 4.0;  matrix[1][3] = 7.0;  matrix[1][4] = 9.0;
-			matrix[1][5] = 1.0;  matrix[1][6] = 3.0;  matrix[1][7] = 4.0;  matrix[1][8] = 5.0;  matrix[1][9] = 2.0;
-			matrix[2][0] = 1.0;  matrix[2][1] = 4.0;  matrix[2][2] = 7.0;  matrix[2][3] = 3.0;  matrix[2][4] = 6.0;
-			matrix[2][5] = 2.0;  matrix[2][6] = 8.0;  matrix[2][7] = 1.0;  matrix[2][8] = 4.0;  matrix[2][9] = 5.0;
-			matrix[3][0] = 4.0;  matrix[3][1] = 7.0;  matrix[3][2] = 3.0;  matrix[3][3] = 8.0;  matrix[3][4] = 2.0;
-			matrix[3][5] = 5.0;  matrix[3][6] = 6.0;  matrix[3][7] = 3.0;  matrix[3][8] = 2.0;  matrix[3][9] = 4.0;
-			matrix[4][0] = 3.0;  matrix[4][1] = 9.0;  matrix[4][2] = 6.0;  matrix[4][3] = 2.0;  matrix[4][4] = 4.0;
-			matrix[4][5] = 7.0;  matrix[4][6] = 1.0;  matrix[4][7] = 5.0;  matrix[4][8] = 3.0;  matrix[4][9] = 6.0;
-			matrix[5][0] = 7.0;  matrix[5][1] = 1.0;  matrix[5][2] = 2.0;  matrix[5][3] = 5.0;  matrix[5][4] = 7.0;
-			matrix[5][5] = 4.0;  matrix[5][6] = 9.0;  matrix[5][7] = 8.0;  matrix[5][8] = 2.0;  matrix[5][9] = 5.0;
-			matrix[6][0] = 2.0;  matrix[6][1] = 3.0;  matrix[6][2] = 8.0;  matrix[6][3] = 6.0;  matrix[6][4] = 1.0;
-			matrix[6][5] = 9.0;  matrix[6][6] = 4.0;  matrix[6][7] = 2.0;  matrix[6][8] = 5.0;  matrix[6][9] = 6.0;
-			matrix[7][0] = 8.0;  matrix[7][1] = 4.0;  matrix[7][2] = 1.0;  matrix[7][3] = 3.0;  matrix[7][4] = 5.0;
-			matrix[7][5] = 2.0;  matrix[7][6] = 8.0;  matrix[7][7] = 6.0;  matrix[7][8] = 1.0;  matrix[7][9] = 3.0;
-			matrix[8][0] = 1.0;  matrix[8][1] = 5.0;  matrix[8][2] = 4.0;  matrix[8][3] = 2.0;  matrix[8][4] = 3.0;
-			matrix[8][5] = 6.0;  matrix[8][6] = 2.0;  matrix[8][7] = 1.0;  matrix[8][8] = 5.0;  matrix[8][9] = 7.0;
-			matrix[9][0] = 3.0;  matrix[9][1] = 2.0;  matrix[9][2] = 5.0;  matrix[9][3] = 4.0;  matrix[9][4] = 6.0;
-			matrix[9][5] = 5.0;  matrix[9][6] = 6.0;  matrix[9][7] = 3.0;  matrix[9][8] = 7.0;  matrix[9][9] = 9.0;
-		}
-		else {
-			printf("Prefab no. %d not implemented\n", settings.prefab);
-		}
-	}
-	if (settings.vandermonde || settings.prefab) {
-		//Run calculations based on the selected model
-		switch (settings.model) {
-		case 0: dynamicForMatrixDeterminant(matrix, settings); break;
-		case 1: taskingMatrixDeterminant(matrix, settings); break;
-		case 2: integratedMasterMatrixDeterminant(matrix, settings); break;
-		default: printf("Bad model\n"); break;
-		}
-		#ifdef _DEBUG
-			// Calculate the determinant
-			det = determinant(matrix);
-			// Check the relative error
-			rel_error = fabs(det - correctDet) / fabs(correctDet);
-		#endif
-	}
-	
-	// Free the result buffer
-	if (matrix != NULL) {
-		for (int i = 0; i < settings.size; i++) {
-			if (matrix[i] != NULL) {
-				free(matrix[i]);
-			}
-		}
-		free(matrix);
-	}
-	#ifdef _DEBUG
-		//print_progress(100);
-		//print results (for vandermonde determinand increases very very VERY fast)
-		printf("\nMy det: %Lf - Correct det: %Lf\n", det, correctDet);
-		printf("Relative error: %.10e\n", rel_error);
-		printf("Matrix determination calculation completed.\n");
-	#endif
-}
-void displayMatrixSettings(SettingsMatrix settings) {
-	const char* model_name;
-
-	switch (settings.model) {
-	case 0: model_name = "dynamic"; break;
-	case 1: model_name = "tasking"; break;
-	case 2: model_name = "integrated"; break;
-	default: model_name = "unknown"; break;
-	}
-
-	printf("----- Settings -----\n");
-	printf("Size		: %d x %d\n", settings.size, settings.size);
-	printf("Vandermonde	: %d\n", settings.vandermonde);
-	printf("Prefab		: %d\n", settings.prefab);
-	printf("Thread count    : %d\n", settings.thread_num);
-	printf("Buffer size     : %d\n", settings.buffer_size);
-	printf("Parallel model  : %s\n", model_name);
-	printf("--------------------\n");
-}
-void displayMatrixHelp() {
-	printf("Usage: MatrixDeterminant [options]\n");
-	printf("Options:\n");
-	printf("  -size <value>   Set the size of the matrix (default: 10)\n");
-	printf("  -vm <value>     Set the Vandermonde matrix flag (default: 1)\n");
-	printf("  -model <value>   Set the parallel model (0: dynamic, 1: tasking, 2: integrated, default: 0)\n");
-	printf("  -prefab <value>  Set the prefab matrix flag (default: 0)\n");
-	printf("  -t <value>      Set the number of threads (default: 4)\n");
-	printf("  -bs <value>     Set the buffer size value (default: 512)\n");
-	printf("  -help           Display this help message\n");
-}
-double** generateMatrix(int size) {
-	double** matrix = (double**)malloc(size * sizeof(double*));
-	if (matrix == NULL) {
-		perror("Memory allocation failed (rows)");
-		exit(EXIT_FAILURE);
-	}
-
-	for (int i = 0; i < size; i++) {
-		matrix[i] = (double*)malloc(size * sizeof(double));
-		if (matrix[i] == NULL) {
-			perror("Memory allocation failed (columns)");
-			exit(EXIT_FAILURE);
-		}
-	}
-	return matrix;
-}
-
-// Merge Sort
-void runMergeSort(int argc, char** argv) {
-	SettingsSort settings;
-	settings.size = 1024;
-	settings.model = 0; // 0 - dynamic, 1 - tasking, 2 - integrated
-	settings.thread_num = 4;
-	settings.buffer_size = 512;
-
-	for (int i = 0; i < argc; i += 2) {
-		if (!strcmp(argv[i], "-size")) {
-			settings.size = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-t")) {
-			settings.thread_num = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-model")) {
-			settings.model = atoi(argv[i + 1]);
-		}
-		else if (!strcmp(argv[i], "-bs")) {
-			settings.buffer_size = atoi(argv[i + 1]);
-		}
-		else {
-			printf("Invalid argument: %s\n", argv[i]);
-			exit(0);
-		}
-	}
-	// Display the settings (once)
-	#ifdef _DEBUG
-		displayMergeSortSettings(settings);
-	#endif
-	// Allocate memory for the array (reverse order) ## worst case ##
-	int* array = generateArray(settings.size);
-	g_array = array;
-	// Run Merge Sort based on the selected model
-	switch (settings.model) {
-	case 0: dynamicForMergeSort(array, settings); break;
-	case 1: taskingMergeSort(array, settings); break;
-	case 2: integratedMasterMergeSort(array, settings); break;
-	default: printf("Bad model\n"); break;
-	}
-	#ifdef _DEBUG
-		print_progress(100);
-
-		//reverse order should now be sorted
-		printf("\nTesting correction...\n");
-		int flag = 0;
-		for (int i = 0; i < arraySize; i++) {
-			if (array[i] != i + 1) {
-				printf("Error: should be %d, is %d\nTesting terminated\n", i + 1, array[i]);
-				flag = 1;
-				break;
-			}
-		}
-		if (flag == 0) {
-			printf("Array sorted correctly.\n");
-		}
-		else {
-			printf("Array not sorted correctly.\n");
-		}
-	#endif
-	free(array);
-}
-void displayMergeSortSettings(SettingsSort settings) {
-	const char* model_name;
-
-	switch (settings.model) {
-	case 0: model_name = "dynamic"; break;
-	case 1: model_name = "tasking"; break;
-	case 2: model_name = "integrated"; break;
-	default: model_name = "unknown"; break;
-	}
-	// Display the settings
-	printf("----- Settings -----\n");
-	printf("Size		: %d\n", settings.size);
-	printf("Thread count    : %d\n", settings.thread_num);
-	printf("Buffer size     : %d\n", settings.buffer_size);
-	printf("Parallel model  : %s\n", model_name);
-	printf("--------------------\n");
-}
-void displayMergeSortHelp() {
-	printf("Usage: MergeSort [options]\n");
-	printf("Options:\n");
-	printf("  -size <value>   Set the size of the array (default: 1000)\n");
-	printf("  -model <value>  Set the parallel model (0: dynamic, 1: tasking, 2: integrated, default: 0)\n");
-	printf("  -t <value>      Set the number of threads (default: 4)\n");
-	printf("  -bs <value>     Set the buffer size value (default: 512)\n");
-	printf("  -help           Display this help message\n");
-}
-int* generateArray(int size) {
-	int* array = (int*)malloc(sizeof(int) * size);
-	if (array == NULL) {
-		perror("Memory allocation failed (array)");
-		exit(EXIT_FAILURE);
-	}
-	for (int i = size; i > 0; i--) {
-		array[size - i] = i;
-	}
-	return array;
-}
-
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <math.h>
+#include <string.h>
+#include <quadmath.h>
+#include "MandelbrotMasterSlave.h"
+#include "MandelbrotImage.h"
+#include "MandelbrotAnimation.h"
+#include "MergeSortMasterSlave.h"
+#include "MatrixDeterminantMasterSlave.h"
+#include "MatrixFile.h"
+#include "MatrixExact.h"
+#include "Energy.h"
+
+
+//To run the program correctly there is only needed to add the first argument
+// - Mb for Mandelbrot
+// - Mx for Matrix Determinant
+// - St for Merge Sort
+
+//For getting help with arguments add -help or -h as the second argument
+//Example: ./mgr Mb -help
+//All arguments are optional, but the first one is required
+//All arguments have their default values, so if you want to run the program with default values, just add the first argument
+
+
+
+int* g_array = NULL;
+//Mandelbrot
+void runMandelbrot(int argc, char** argv);
+void displayMandelbrotSettings(SettingsMandelbrot settings);
+void displayMandelbrotHelp();
+
+//Matrix
+void runMatrixDeterminant(int argc, char** argv);
+void displayMatrixSettings(SettingsMatrix settings);
+void displayMatrixHelp();
+
+// Merge Sort
+void runMergeSort(int argc, char** argv);
+void displayMergeSortSettings(SettingsSort settings);
+void displayMergeSortHelp();
+int* generateArray(int size, int threadnum);
+
+int main(int argc, char** argv) {
+
+#ifdef _DEBUG
+	FILE* fp = fopen("debug.txt", "w");
+	fclose(fp);
+#endif
+   
+	if (argc > 1) {
+		if (!strcmp(argv[1], "Mb")) {
+			if (argc > 2 && (!strcmp(argv[2], "-help") || !strcmp(argv[2], "-h"))) {
+				// Display help for Mandelbrot arguments
+				displayMandelbrotHelp();
+			}
+			else {
+				//Run Mandelbrot calculation with remaining arguments
+				runMandelbrot(argc - 2, argv + 2);
+			}
+		}
+		else if (!strcmp(argv[1], "Mx")) {
+			if (argc > 2 && (!strcmp(argv[2], "-help") || !strcmp(argv[2], "-h"))) {
+				// Display help for Matrix arguments
+				displayMatrixHelp();
+			}
+			else {
+				//Run Matrix Determinant calculation with remaining arguments
+				runMatrixDeterminant(argc - 2, argv + 2);
+			}
+		}
+		else if (!strcmp(argv[1], "St")) {
+			if (argc > 2 && (!strcmp(argv[2], "-help") || !strcmp(argv[2], "-h"))) {
+				//Display help for Merge Sort arguments
+				displayMergeSortHelp();
+			}
+			else {
+				//Run Merge Sort calculation with remaining arguments
+				runMergeSort(argc - 2, argv + 2);
+			}
+		}
+		else {
+			printf("Invalid first argument. Use 'Mb' for Mandelbrot, 'Mx' for Matrix Determinant, or 'St' for Merge Sort.\n");
+		}
+	}
+	else {
+		printf("No arguments provided. Use 'Mb' for Mandelbrot, 'Mx' for Matrix Determinant, or 'St' for Merge Sort.\n");
+	}
+		
+    return 0;
+}
+//Mandelbrot
+void runMandelbrot(int argc, char** argv) {
+	SettingsMandelbrot settings;
+	settings.re_min = -2.0;
+	settings.re_max = 1.0;
+	settings.im_min = -1.5;
+	settings.im_max = 1.5;
+	settings.max_iterations = 1000;
+	settings.image_width = 1920;
+	settings.image_height = 1080;
+	settings.block_size = 8;
+	settings.thread_num = 4;
+	settings.buffer_size = 512;
+	settings.model = 0; // 0 - dynamic, 1 - tasking, 2 - integrated
+	settings.affinity = 0;
+	settings.order = 0; // 0 - column, 1 - heaviest first, 2 - Morton, 3 - Hilbert
+	settings.preview_iterations = 64;
+	settings.output = NULL;
+	settings.format = 0; // 0 - PPM, 1 - 16-bit PGM
+	settings.stream = NULL;
+	settings.inflight = 64;
+	settings.deep = 0;
+	settings.frames = 0;
+	settings.path = NULL;
+	settings.precision = 0; // 0 - auto, 1 - float, 2 - double
+	settings.validate = 0;
+	settings.report = 0;
+	settings.cache = 0;
+	settings.cachefile = NULL;
+	settings.cacheslots = 65536;
+	settings.symmetry = 1;
+	settings.fractal = 0; // 0 - Mandelbrot, 1 - Julia, 2 - Burning Ship, 3 - Multibrot
+	settings.julia_re = -0.8;
+	settings.julia_im = 0.156;
+	settings.degree = 3;
+	settings.progressive = 0;
+	// Complex range as typed, parsed again in quad precision for the deep zoom mode
+	const char* view_text[4] = { "-2.0", "1.0", "-1.5", "1.5" };
+
+	// Parse command line arguments
+	for (int i = 0; i < argc; i+=2) {
+		if (!strcmp(argv[i], "-rmin")) {
+			settings.re_min = atof(argv[i + 1]);
+			view_text[0] = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-rmax")) {
+			settings.re_max = atof(argv[i + 1]);
+			view_text[1] = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-imin")) {
+			settings.im_min = atof(argv[i + 1]);
+			view_text[2] = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-imax")) {
+			settings.im_max = atof(argv[i + 1]);
+			view_text[3] = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-w")) {
+			settings.image_width = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-h")) {
+			settings.image_height = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-b")) {
+			settings.block_size = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-t")) {
+			settings.thread_num = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-it")) {
+			settings.max_iterations = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-model")) {
+			settings.model = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-affinity")) {
+			settings.affinity = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-bs")) {
+			settings.buffer_size = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-order")) {
+			settings.order = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-pit")) {
+			settings.preview_iterations = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-o")) {
+			settings.output = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-fmt")) {
+			settings.format = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-stream")) {
+			settings.stream = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-inflight")) {
+			settings.inflight = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-deep")) {
+			settings.deep = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-frames")) {
+			settings.frames = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-path")) {
+			settings.path = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-precision")) {
+			settings.precision = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-validate")) {
+			settings.validate = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-report")) {
+			settings.report = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-cache")) {
+			settings.cache = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-cachefile")) {
+			settings.cachefile = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-cacheslots")) {
+			settings.cacheslots = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-sym")) {
+			settings.symmetry = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-fractal")) {
+			settings.fractal = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-cre")) {
+			settings.julia_re = atof(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-cim")) {
+			settings.julia_im = atof(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-d")) {
+			settings.degree = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-progressive")) {
+			settings.progressive = atoi(argv[i + 1]);
+		}
+		else {
+			printf("Invalid argument: %s\n", argv[i]);
+			exit(0);
+		}
+	}
+	// Display the settings (once)
+	#ifdef _DEBUG
+		displayMandelbrotSettings(settings);
+	#endif
+	if (settings.fractal < 0 || settings.fractal > 3) {
+		printf("Bad fractal\n");
+		exit(0);
+	}
+	if (settings.fractal == 3 && settings.degree < 2) {
+		printf("Multibrot degree (-d) must be at least 2.\n");
+		exit(0);
+	}
+	if (settings.deep && settings.fractal != 0) {
+		printf("Deep zoom mode is only available for the Mandelbrot set.\n");
+		exit(0);
+	}
+	if (settings.affinity && settings.model != 0) {
+		printf("Affinity option is available for the dynamic model only.\n");
+		exit(0);
+	}
+	// Tile cache, reused by all frames of an animation and kept in the cache file between runs
+	if (settings.cache > 0 || settings.cachefile != NULL) {
+		if (settings.stream != NULL) {
+			printf("Tile cache is not available in streaming mode.\n");
+			exit(0);
+		}
+		tile_cache = open_cache_Mandelbrot(settings.cache, settings.cachefile, settings.cacheslots, settings.block_size);
+		if (tile_cache == NULL) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	// Animation mode renders a whole zoom sequence in this process
+	if (settings.frames > 0 || settings.path != NULL) {
+		if (settings.frames < 1 || settings.path == NULL) {
+			printf("Animation mode needs both -frames and -path.\n");
+			exit(0);
+		}
+		if (settings.stream != NULL) {
+			printf("Streaming mode is not available for animations.\n");
+			exit(0);
+		}
+		if (settings.progressive) {
+			printf("Progressive mode is not available for animations.\n");
+			exit(0);
+		}
+		int animation_error = animateMandelbrot(settings);
+		if (tile_cache != NULL) {
+			close_cache_Mandelbrot(tile_cache);
+			tile_cache = NULL;
+		}
+		if (animation_error != 0)
+			exit(EXIT_FAILURE);
+		return;
+	}
+	// Deep zoom mode, one quad precision reference orbit for the whole view
+	if (settings.deep) {
+		prepare_deep_Mandelbrot(strtoflt128(view_text[0], NULL), strtoflt128(view_text[1], NULL),
+			strtoflt128(view_text[2], NULL), strtoflt128(view_text[3], NULL),
+			settings.image_width, settings.image_height, settings.max_iterations);
+	}
+	int** result_buffer = NULL;
+	//the result buffer is zeroed apart from the kernel, its time and energy are reported separately
+	t_energy_sample generation_before, generation_after;
+	read_energy(&generation_before);
+	double generation_time = omp_get_wtime();
+	if (settings.stream != NULL) {
+		// Streaming mode, tiles go straight to the tiled output file and the image is never kept in memory
+		if (settings.output != NULL) {
+			printf("Image output (-o) is not available in streaming mode.\n");
+			exit(0);
+		}
+		if (settings.progressive) {
+			printf("Progressive mode is not available in streaming mode.\n");
+			exit(0);
+		}
+		tile_stream = open_stream_Mandelbrot(settings.stream, settings.image_width, settings.image_height,
+			settings.block_size, settings.max_iterations, settings.inflight);
+		if (tile_stream == NULL) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	else {
+		// Allocate memory for the result buffer
+		result_buffer = allocate_image_Mandelbrot(settings.image_width, settings.image_height, settings.thread_num);
+	}
+	generation_time = omp_get_wtime() - generation_time;
+	read_energy(&generation_after);
+	t_energy_sample energy_before, energy_after;
+	read_energy(&energy_before);
+	double time_before = omp_get_wtime();
+	// Progressive mode, every level is saved to the output as soon as it is finished
+	if (settings.progressive) {
+		progressive_sink = open_progressive_Mandelbrot(settings.output, settings.format,
+			settings.image_width, settings.image_height, result_buffer);
+	}
+	// Run Mandelbrot calculation based on the selected model
+	switch (settings.model) {
+		case 0: dynamicForMandelbrot(result_buffer, settings); break;
+		case 1: taskingMandelbrot(result_buffer, settings); break;
+		case 2: integratedMasterMandelbrot(result_buffer, settings); break;
+		default: printf("Bad model\n"); break;
+	}
+	// Wait for the writer to flush the remaining tiles, a failed write fails the run
+	if (tile_stream != NULL) {
+		int stream_error = close_stream_Mandelbrot(tile_stream);
+		tile_stream = NULL;
+		if (stream_error != 0)
+			exit(EXIT_FAILURE);
+	}
+	// Publish the full resolution level, a level that could not be saved fails the run
+	if (progressive_sink != NULL && close_progressive_Mandelbrot(progressive_sink, settings.thread_num) != 0) {
+		exit(EXIT_FAILURE);
+	}
+	double working_time = omp_get_wtime() - time_before;
+	read_energy(&energy_after);
+	// Save the result as an image file (already saved in progressive mode), a failed write fails the run
+	if (settings.output != NULL && progressive_sink == NULL
+		&& save_image_Mandelbrot(settings.output, result_buffer, settings.format, settings.thread_num) != 0) {
+		exit(EXIT_FAILURE);
+	}
+	if (settings.report) {
+		const char* precision_name = selected_precision == 1 ? "float" : selected_precision == 2 ? "double" : "deep zoom";
+		double pixels = (double)settings.image_width * settings.image_height;
+		double energy = energy_between(&energy_before, &energy_after);
+		printf("Kernel precision: %s\n", precision_name);
+		printf("Mirrored rows   : %d of %d\n", mirrored_rows, settings.image_height);
+		printf("Working time    : %.6f s\n", working_time);
+		if (energy >= 0) {
+			printf("Energy          : %.6f J\n", energy);
+			printf("Energy per pixel: %.3e J\n", energy / pixels);
+		}
+		else {
+			printf("Energy          : n/a (RAPL counters not available)\n");
+		}
+		energy = energy_between(&generation_before, &generation_after);
+		if (energy >= 0)
+			printf("Generation      : %.6f s, %.6f J\n", generation_time, energy);
+		else
+			printf("Generation      : %.6f s\n", generation_time);
+		if (settings.affinity)
+			printf("Stolen packets  : %ld of %ld\n", affinity_stolen, affinity_packets);
+		if (tile_cache != NULL)
+			printf("Tile cache      : %lld memory hits, %lld disk hits, %lld misses\n",
+				tile_cache->memory_hits, tile_cache->disk_hits, tile_cache->misses);
+		if (progressive_sink != NULL) {
+			printf("First image     : %.6f s\n", progressive_sink->level_time[0]);
+			for (int level = 0; level < progressive_sink->levels; level++) {
+				int step = 1 << (progressive_sink->levels - 1 - level);
+				printf("Level %d (1/%-3d) : %.6f s\n", level, step * step, progressive_sink->level_time[level]);
+			}
+		}
+	}
+	if (progressive_sink != NULL) {
+		free_progressive_Mandelbrot(progressive_sink);
+		progressive_sink = NULL;
+	}
+	// Compare the iteration counts with the double precision kernel
+	if (settings.validate > 0 && result_buffer != NULL) {
+		double within;
+		double same = validate_precision_Mandelbrot(result_buffer, settings.validate, settings.thread_num, &within);
+		printf("Agreement with double: %.4f%% identical, %.4f%% within 1%% of max iterations\n", 100 * same, 100 * within);
+	}
+	#ifdef _DEBUG
+		if (settings.deep)
+			printf("\nReference orbit length: %d, rebased pixels: %lld\n", deep_orbit_length, deep_glitches);
+	#endif
+	free_deep_Mandelbrot();
+	if (tile_cache != NULL) {
+		close_cache_Mandelbrot(tile_cache);
+		tile_cache = NULL;
+	}
+	// Free the result buffer
+	if (result_buffer != NULL) {
+		for (int i = 0; i < settings.image_height; i++) {
+			free(result_buffer[i]);
+		}
+		free(result_buffer);
+	}
+	#ifdef _DEBUG
+		print_progress(100);
+		if (settings.stream != NULL)
+			printf("\nMandelbrot set calculation completed. Tiles streamed to %s\n", settings.stream);
+		else if (settings.output != NULL)
+			printf("\nMandelbrot set calculation completed. Result saved to %s\n", settings.output);
+		else
+			printf("\nMandelbrot set calculation completed.\n");
+	#endif
+}
+void displayMandelbrotSettings(SettingsMandelbrot settings) {
+	const char* model_name;
+	const char* order_name;
+	const char* fractal_name;
+
+	switch (settings.model) {
+	case 0: model_name = "dynamic"; break;
+	case 1: model_name = "tasking"; break;
+	case 2: model_name = "integrated"; break;
+	default: model_name = "unknown"; break;
+	}
+	switch (settings.order) {
+	case 0: order_name = "column"; break;
+	case 1: order_name = "heaviest first"; break;
+	case 2: order_name = "Morton"; break;
+	case 3: order_name = "Hilbert"; break;
+	default: order_name = "unknown"; break;
+	}
+
+	switch (settings.fractal) {
+	case 0: fractal_name = "Mandelbrot"; break;
+	case 1: fractal_name = "Julia"; break;
+	case 2: fractal_name = "Burning Ship"; break;
+	case 3: fractal_name = "Multibrot"; break;
+	default: fractal_name = "unknown"; break;
+	}
+
+	printf("----- Settings -----\n");
+	printf("Resolution      : %d x %d\n", settings.image_width, settings.image_height);
+	printf("Complex range   : re = [%.2f, %.2f], im = [%.2f, %.2f]\n",
+		settings.re_min, settings.re_max, settings.im_min, settings.im_max);
+	printf("Max iterations  : %d\n", settings.max_iterations);
+	printf("Block size      : %d\n", settings.block_size);
+	printf("Thread count    : %d\n", settings.thread_num);
+	printf("Buffer size     : %d\n", settings.buffer_size);
+	printf("Parallel model  : %s\n", model_name);
+	if (settings.affinity)
+		printf("Affinity        : owner-computes queues\n");
+	printf("Tile order      : %s\n", order_name);
+	if (settings.order == 1)
+		printf("Preview iter.   : %d\n", settings.preview_iterations);
+	printf("Output          : %s\n", settings.output != NULL ? settings.output : "none");
+	if (settings.output != NULL)
+		printf("Output format   : %s\n", settings.format == 0 ? "PPM" : "16-bit PGM");
+	printf("Deep zoom       : %d\n", settings.deep);
+	printf("Fractal         : %s\n", fractal_name);
+	if (settings.fractal == 1)
+		printf("Julia constant  : %g %+gi\n", settings.julia_re, settings.julia_im);
+	if (settings.fractal == 3)
+		printf("Degree          : %d\n", settings.degree);
+	printf("Precision       : %s\n", settings.precision == 1 ? "float" : settings.precision == 2 ? "double" : "auto");
+	printf("Symmetry        : %s\n", settings.symmetry ? "on" : "off");
+	printf("Progressive     : %s\n", settings.progressive ? "on" : "off");
+	if (settings.frames > 0) {
+		printf("Frames          : %d\n", settings.frames);
+		printf("Keyframe path   : %s\n", settings.path != NULL ? settings.path : "none");
+	}
+	if (settings.stream != NULL) {
+		printf("Stream file     : %s\n", settings.stream);
+		printf("Tiles in flight : %d\n", settings.inflight);
+	}
+	if (settings.cache > 0 || settings.cachefile != NULL) {
+		printf("Tile cache      : %d tiles\n", settings.cache);
+		printf("Cache file      : %s\n", settings.cachefile != NULL ? settings.cachefile : "none");
+		if (settings.cachefile != NULL)
+			printf("Cache file slots: %d\n", settings.cacheslots);
+	}
+	printf("--------------------\n");
+}
+void displayMandelbrotHelp() {
+	printf("Usage: Mandelbrot [options]\n");
+	printf("Options:\n");
+	printf("  -rmin <value>   Set the minimum real part (default: -2.0)\n");
+	printf("  -rmax <value>   Set the maximum real part (default: 1.0)\n");
+	printf("  -imin <value>   Set the minimum imaginary part (default: -1.5)\n");
+	printf("  -imax <value>   Set the maximum imaginary part (default: 1.5)\n");
+	printf("  -w <value>      Set the image width (default: 1920)\n");
+	printf("  -h <value>      Set the image height (default: 1080)\n");
+	printf("  -b <value>      Set the block size (default: 8)\n");
+	printf("  -t <value>      Set the number of threads (default: 4)\n");
+	printf("  -it <value>      Set the maximum iterations (default: 1000)\n");
+	printf("  -bs <value>     Set the buffer size value (default: 512)\n");
+	printf("  -model <value>  Set the parallel model (0: dynamic, 1: tasking, 2: integrated, default: 0)\n");
+	printf("  -affinity <value> Dynamic model: every thread takes the tiles of its own tile columns first (default: 0)\n");
+	printf("  -order <value>  Set the tile order (0: column, 1: heaviest first, 2: Morton, 3: Hilbert, default: 0)\n");
+	printf("  -pit <value>    Set the preview iterations used to estimate tile cost for -order 1 (default: 64)\n");
+	printf("  -o <file>       Save the result to an image file (default: none)\n");
+	printf("  -fmt <value>    Set the image format (0: PPM, 1: 16-bit PGM with raw iterations, default: 0)\n");
+	printf("  -stream <file>  Stream finished tiles to a tiled 16-bit file without keeping the image in memory\n");
+	printf("  -inflight <value> Set the maximum number of tiles in flight in streaming mode (default: 64)\n");
+	printf("  -deep <value>   Use the perturbation deep zoom kernel with a quad precision reference orbit (default: 0)\n");
+	printf("  -precision <value> Set the kernel precision (0: auto from the pixel spacing, 1: float, 2: double, default: 0)\n");
+	printf("  -validate <value> Compare every n-th pixel of every n-th row with the double kernel (default: 0 - off)\n");
+	printf("  -report <value> Print the kernel precision, working time and energy per pixel (default: 0)\n");
+	printf("  -fractal <value> Set the fractal (0: Mandelbrot, 1: Julia, 2: Burning Ship, 3: Multibrot, default: 0)\n");
+	printf("  -cre <value>    Set the real part of the Julia constant c (default: -0.8)\n");
+	printf("  -cim <value>    Set the imaginary part of the Julia constant c (default: 0.156)\n");
+	printf("  -d <value>      Set the degree of the Multibrot set z^d + c (default: 3)\n");
+	printf("  -progressive <value> Render 1/16, 1/4 and then all pixels, every level is saved to -o when finished\n");
+	printf("                  (-o may contain a level number pattern, for example level%%d.ppm, default: 0)\n");
+	printf("  -sym <value>    Copy the rows mirrored about the real axis instead of computing them (default: 1)\n");
+	printf("  -cache <value>  Keep this many computed tiles in memory and reuse them for the same or panned views (default: 0)\n");
+	printf("  -cachefile <file> Keep computed tiles in a persistent cache file as well\n");
+	printf("  -cacheslots <value> Set the number of tile slots of the cache file (default: 65536)\n");
+	printf("  -frames <value> Render an animation of this many frames along the -path keyframes\n");
+	printf("  -path <file>    Keyframe file, one \"center_re center_im radius\" line per keyframe\n");
+	printf("                  (animation output -o needs a frame number pattern, for example frame%%04d.ppm)\n");
+	printf("  -help           Display this help message\n");
+}
+
+//Matrix
+static const char* engine_names[] = { "row by row", "blocked LU", "recursive LU", "Bareiss (exact)" };
+
+void runMatrixDeterminant(int argc, char** argv) {
+	SettingsMatrix settings;
+	settings.size = 10;
+	settings.vandermonde = 1;
+	settings.model = 0; // 0 - dynamic, 1 - tasking, 2 - integrated, 3 - dataflow
+	settings.prefab = 0; // 1 - 4x4, 2 - 10x10
+	settings.thread_num = 4;
+	settings.buffer_size = 512;
+	settings.engine = 0; // 0 - row by row elimination, 1 - blocked LU, 2 - recursive LU, 3 - Bareiss
+	settings.block = 64;
+	settings.report = 0;
+	settings.simd = 0;
+	settings.pivot = -1; // -1 - off for Vandermonde matrices, on for the others
+	settings.random = 0;
+	settings.integers = 0;
+	settings.batch = 0;
+	settings.input = NULL;
+	settings.dump = NULL;
+	settings.solve = 0;
+	settings.affinity = 0;
+
+	t_matrix* matrix = NULL;
+	int mapped = 0;
+	
+	#ifdef _DEBUG
+		//determinants are compared as sign and log|det|, Vandermonde determinants overflow a long double
+		long double correctLogDet = 0;
+		long double logDet = 0;
+		int correctSign = 0;
+		int sign = 0;
+		int reference = 1;
+		double rel_error = 0;
+		long double* batchReference = NULL;
+		char* exactDet = NULL;
+		t_matrix* original = NULL; // A, for the residual of the solve
+		double solve_residual = 0;
+		double batch_error = 0;
+	#endif
+	// Parse command line arguments
+	for (int i = 0; i < argc; i += 2) {
+		if (!strcmp(argv[i], "-size")) {
+			settings.size = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-vm")) {
+			if (settings.prefab == 0) {
+				settings.vandermonde = atoi(argv[i + 1]);
+			}
+			else {
+				printf("Vandermonde option is not available for prefab matrices.\n");
+				exit(0);
+			}
+		}
+		else if (!strcmp(argv[i], "-model")) {
+			settings.model = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-affinity")) {
+			settings.affinity = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-prefab")) {
+			if (settings.vandermonde == 1) {
+				printf("Prefab option is not available for Vandermonde matrices.\n");
+				exit(0);
+			}
+			else {
+				settings.prefab = atoi(argv[i + 1]);
+			}		
+		}
+		else if (!strcmp(argv[i], "-random")) {
+			if (settings.vandermonde == 1 || settings.prefab != 0) {
+				printf("Random option is not available for Vandermonde and prefab matrices.\n");
+				exit(0);
+			}
+			else {
+				settings.random = (unsigned int)strtoul(argv[i + 1], NULL, 10);
+			}
+		}
+		else if (!strcmp(argv[i], "-integers")) {
+			settings.integers = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-input")) {
+			if (settings.vandermonde == 1 || settings.prefab != 0) {
+				printf("Input option is not available for Vandermonde and prefab matrices.\n");
+				exit(0);
+			}
+			else {
+				settings.input = argv[i + 1];
+			}
+		}
+		else if (!strcmp(argv[i], "-dump")) {
+			settings.dump = argv[i + 1];
+		}
+		else if (!strcmp(argv[i], "-solve")) {
+			settings.solve = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-batch")) {
+			settings.batch = atol(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-pivot")) {
+			settings.pivot = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-t")) {
+			settings.thread_num = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-bs")) {
+			settings.buffer_size = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-engine")) {
+			settings.engine = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-simd")) {
+			settings.simd = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-nb")) {
+			settings.block = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-report")) {
+			settings.report = atoi(argv[i + 1]);
+		}
+		else {
+			printf("Invalid argument: %s\n", argv[i]);
+			exit(0);
+		}
+	}
+	if (settings.engine < 0 || settings.engine > 3) {
+		printf("Bad engine\n");
+		exit(0);
+	}
+	//the batched mode has one lane kernel for all models, the engines work on a single matrix
+	if (settings.batch > 0 && settings.engine != 0) {
+		printf("Batched mode (-batch) has its own kernel and takes no -engine.\n");
+		exit(0);
+	}
+	if (settings.engine == 2 && settings.model == 3 && settings.batch == 0) {
+		printf("The recursive LU engine runs on the dynamic, tasking and integrated models only.\n");
+		exit(0);
+	}
+	if (settings.solve < 0 || (settings.solve > 0 && (settings.engine == 3 || settings.batch > 0))) {
+		printf("Solve option needs a floating point engine (0..2) and no batched mode.\n");
+		exit(0);
+	}
+	if (settings.integers < 0) {
+		printf("Integer range (-integers) must not be negative.\n");
+		exit(0);
+	}
+	if (settings.affinity && settings.model != 0) {
+		printf("Affinity option is available for the dynamic model only.\n");
+		exit(0);
+	}
+	if (settings.block < 1) {
+		printf("Block size (-nb) must be at least 1.\n");
+		exit(0);
+	}
+	//interchanges cost the Vandermonde matrices of integer nodes their nearly exact elimination
+	if (settings.pivot < 0)
+		settings.pivot = !settings.vandermonde;
+	//Display the settings (once)
+	#ifdef _DEBUG
+		displayMatrixSettings(settings);
+	#endif
+	//Generate matrix to calculate and instantly determine the correct determinant
+	//if the vandermonde flag is set (default), generation is measured apart from the kernel
+	t_energy_sample generation_before, generation_after;
+	read_energy(&generation_before);
+	double generation_time = omp_get_wtime();
+	if (settings.vandermonde) {
+		matrix = generateVandermondeMatrix(settings.size, settings.thread_num);
+		#ifdef _DEBUG
+			correctSign = 1;
+			correctLogDet = vandermondeLogDeterminant(settings.size);
+		#endif
+	}
+	else if (settings.input != NULL) {
+		//file reading happens here, before the timed part
+		matrix = load_Matrix(settings.input, settings.thread_num, &mapped);
+		if (matrix == NULL)
+			exit(EXIT_FAILURE);
+		settings.size = matrix->size;
+		if (matrix->batch != NULL && settings.engine != 0) {
+			printf("%s holds a batch of matrices, the batched mode takes no -engine.\n", settings.input);
+			exit(0);
+		}
+		if (matrix->batch != NULL)
+			settings.batch = matrix->batch->count;
+		#ifdef _DEBUG
+			reference = 0;
+		#endif
+	}
+	else if (settings.random) {
+		if (settings.integers > 0)
+			matrix = generateRandomIntegerMatrix(settings.size, settings.random, settings.integers, settings.thread_num);
+		else
+			matrix = generateRandomMatrix(settings.size, settings.random, settings.thread_num);
+		#ifdef _DEBUG
+			reference = 0;
+		#endif
+	}
+	else {
+		//Save from first tests 
+		if (settings.prefab == 1) {
+			settings.size = 4;
+			matrix = allocate_Matrix(settings.size);
+			#ifdef _DEBUG
+				correctSign = -1;
+				correctLogDet = logl(89.0L);
+			#endif
+
+			static const double prefab[4][4] = {
+				{ 2.0, 1.0, -1.0, 2.0 },
+				{ -3.0, -1.0, 2.0, -11.0 },
+				{ -2.0, 1.0, 2.0, -3.0 },
+				{ 1.0, 2.0, 3.0, 4.0 }
+			};
+			for (int i = 0; i < 4; i++)
+				for (int j = 0; j < 4; j++)
+					MATRIX_ROW(matrix, i)[j] = prefab[i][j];
+		}
+		else if (settings.prefab == 2) {
+			settings.size = 10;
+			matrix = allocate_Matrix(settings.size);
+			#ifdef _DEBUG
+				correctSign = -1;
+				correctLogDet = logl(4683298.0L);
+			#endif
+			
+
+			static const double prefab[10][10] = {
+				{ 5.0, 2.0, 1.0, 4.0, 3.0, 7.0, 2.0, 8.0, 1.0, 3.0 },
+				{ 2.0, 6.0, 4.0, 7.0, 9.0, 1.0, 3.0, 4.0, 5.0, 2.0 },
+				{ 1.0, 4.0, 7.0, 3.0, 6.0, 2.0, 8.0, 1.0, 4.0, 5.0 },
+				{ 4.0, 7.0, 3.0, 8.0, 2.0, 5.0, 6.0, 3.0, 2.0, 4.0 },
+				{ 3.0, 9.0, 6.0, 2.0, 4.0, 7.0, 1.0, 5.0, 3.0, 6.0 },
+				{ 7.0, 1.0, 2.0, 5.0, 7.0, 4.0, 9.0, 8.0, 2.0, 5.0 },
+				{ 2.0, 3.0, 8.0, 6.0, 1.0, 9.0, 4.0, 2.0, 5.0, 6.0 },
+				{ 8.0, 4.0, 1.0, 3.0, 5.0, 2.0, 8.0, 6.0, 1.0, 3.0 },
+				{ 1.0, 5.0, 4.0, 2.0, 3.0, 6.0, 2.0, 1.0, 5.0, 7.0 },
+				{ 3.0, 2.0, 5.0, 4.0, 6.0, 5.0, 6.0, 3.0, 7.0, 9.0 }
+			};
+			for (int i = 0; i < 10; i++)
+				for (int j = 0; j < 10; j++)
+					MATRIX_ROW(matrix, i)[j] = prefab[i][j];
+		}
+		else {
+			printf("Prefab no. %d not implemented\n", settings.prefab);
+		}
+	}
+	//Batched mode: copies of the matrix above, or random matrices of its order with -random
+	if (matrix != NULL && settings.batch > 0 && matrix->batch == NULL)
+		matrix->batch = generateBatchMatrix(matrix, settings.batch, settings.random, settings.thread_num);
+	generation_time = omp_get_wtime() - generation_time;
+	read_energy(&generation_after);
+	#ifdef _DEBUG
+		if (matrix != NULL && settings.batch > 0) {
+			batchReference = (long double*)malloc(sizeof(long double) * settings.batch);
+			if (batchReference == NULL) {
+				perror("Memory allocation failed (reference)");
+				exit(EXIT_FAILURE);
+			}
+			for (long b = 0; b < settings.batch; b++)
+				batchReference[b] = batch_reference_Matrix(matrix->batch, b);
+		}
+	#endif
+	if (matrix != NULL && settings.engine == 3 && matrix->batch == NULL && !integer_Matrix(matrix)) {
+		printf("The Bareiss engine needs a matrix of integers of at most 53 bits (-integers for random matrices).\n");
+		exit(0);
+	}
+	if (matrix != NULL && settings.dump != NULL && dump_Matrix(settings.dump, matrix, settings.thread_num) != 0)
+		exit(EXIT_FAILURE);
+	#ifdef _DEBUG
+		if (matrix != NULL && settings.solve > 0) {
+			original = allocate_Matrix(settings.size);
+			memcpy(original->data, matrix->data, sizeof(double) * (size_t)matrix->ld * settings.size);
+		}
+	#endif
+	if (matrix != NULL) {
+		t_energy_sample energy_before, energy_after;
+		read_energy(&energy_before);
+		double time_before = omp_get_wtime();
+		//Run calculations based on the selected model
+		factorMatrix(matrix, settings);
+		double working_time = omp_get_wtime() - time_before;
+		read_energy(&energy_after);
+		if (settings.report && matrix->batch != NULL) {
+			double energy = energy_between(&energy_before, &energy_after);
+			printf("Batch           : %ld matrices of order %d\n", settings.batch, settings.size);
+			printf("Lane kernel     : %s\n", matrix_kernel);
+			if (settings.input != NULL)
+				printf("Input           : %s, copied\n", settings.input);
+			printf("Pivoting        : %s\n", settings.pivot ? "partial" : "none");
+			printf("Working time    : %.6f s\n", working_time);
+			printf("Throughput      : %.0f determinants/s\n", settings.batch / working_time);
+			if (energy >= 0) {
+				printf("Energy          : %.6f J\n", energy);
+				printf("Determinants/J  : %.0f\n", settings.batch / energy);
+			}
+			else {
+				printf("Energy          : n/a (RAPL counters not available)\n");
+			}
+		}
+		else if (settings.report && settings.engine == 3) {
+			//n^3 / 3 element updates of two multiplications, a subtraction and an exact division each
+			double updates = settings.size * (double)settings.size * settings.size / 3.0;
+			double energy = energy_between(&energy_before, &energy_after);
+			printf("Engine          : %s\n", engine_names[settings.engine]);
+			printf("Integer limbs   : %d .. %d (up to 2 on __int128)\n", matrix->exact->width[0], matrix->exact->limbs);
+			printf("Pivoting        : %s\n", settings.pivot ? "first nonzero" : "none");
+			printf("Working time    : %.6f s\n", working_time);
+			printf("Throughput      : %.3f G updates/s\n", updates / working_time * 1e-9);
+			if (energy >= 0) {
+				printf("Energy          : %.6f J\n", energy);
+				printf("G updates/joule : %.3f\n", updates / energy * 1e-9);
+			}
+			else {
+				printf("Energy          : n/a (RAPL counters not available)\n");
+			}
+		}
+		else if (settings.report) {
+			//nominal LU flop count, the same for all floating point engines
+			double flops = 2.0 / 3.0 * settings.size * (double)settings.size * settings.size;
+			double energy = energy_between(&energy_before, &energy_after);
+			printf("Engine          : %s\n", engine_names[settings.engine]);
+			printf("Row kernel      : %s\n", matrix_kernel);
+			if (settings.input != NULL)
+				printf("Input           : %s, %s\n", settings.input, mapped ? "mapped" : "copied");
+			printf("Pivoting        : %s\n", settings.pivot ? "partial" : "none");
+			printf("Working time    : %.6f s\n", working_time);
+			printf("Throughput      : %.3f GFLOP/s\n", flops / working_time * 1e-9);
+			if (energy >= 0) {
+				printf("Energy          : %.6f J\n", energy);
+				printf("GFLOP per joule : %.3f\n", flops / energy * 1e-9);
+			}
+			else {
+				printf("Energy          : n/a (RAPL counters not available)\n");
+			}
+		}
+		if (settings.report && settings.affinity)
+			printf("Stolen packets  : %ld of %ld\n", affinity_stolen, affinity_packets);
+		if (settings.report) {
+			double energy = energy_between(&generation_before, &generation_after);
+			if (energy >= 0)
+				printf("Generation      : %.6f s, %.6f J\n", generation_time, energy);
+			else
+				printf("Generation      : %.6f s\n", generation_time);
+		}
+		//Solves with the factors, the right-hand sides are generated outside the measured part
+		if (settings.solve > 0) {
+			t_rhs_matrix* rhs = generateRhsMatrix(settings.size, settings.solve, settings.random + 1, settings.thread_num);
+			read_energy(&energy_before);
+			time_before = omp_get_wtime();
+			solveMatrix(matrix, rhs, settings);
+			double solve_time = omp_get_wtime() - time_before;
+			read_energy(&energy_after);
+			if (settings.report) {
+				//forward and back substitution, n^2 multiply-adds per right-hand side together
+				double flops = 2.0 * settings.size * (double)settings.size * settings.solve;
+				double energy = energy_between(&energy_before, &energy_after);
+				printf("Right-hand sides: %d\n", settings.solve);
+				printf("Solve time      : %.6f s (%.1f solves per factorisation time)\n", solve_time, working_time / solve_time);
+				printf("Solve throughput: %.3f GFLOP/s\n", flops / solve_time * 1e-9);
+				if (energy >= 0)
+					printf("Solve energy    : %.6f J\n", energy);
+			}
+			#ifdef _DEBUG
+				//max over the right-hand sides of |A x - b| / (|A| |x|), infinity norms
+				t_rhs_matrix* b = generateRhsMatrix(settings.size, settings.solve, settings.random + 1, settings.thread_num);
+				double norm = 0;
+				for (int i = 0; i < settings.size; i++) {
+					double sum = 0;
+					for (int j = 0; j < settings.size; j++)
+						sum += fabs(MATRIX_ROW(original, i)[j]);
+					norm = sum > norm ? sum : norm;
+				}
+				for (int c = 0; c < settings.solve; c++) {
+					double error = 0, x_norm = 0;
+					for (int i = 0; i < settings.size; i++) {
+						double r = -RHS_ROW(b, i)[c];
+						for (int j = 0; j < settings.size; j++)
+							r += MATRIX_ROW(original, i)[j] * RHS_ROW(rhs, j)[c];
+						error = fabs(r) > error ? fabs(r) : error;
+						x_norm = fabs(RHS_ROW(rhs, i)[c]) > x_norm ? fabs(RHS_ROW(rhs, i)[c]) : x_norm;
+					}
+					if (error / (norm * x_norm) > solve_residual)
+						solve_residual = error / (norm * x_norm);
+				}
+				free_rhs_Matrix(b);
+				free_Matrix(original);
+			#endif
+			free_rhs_Matrix(rhs);
+		}
+		#ifdef _DEBUG
+			// Calculate the determinant (of the first matrix in the batched mode)
+			if (matrix->batch != NULL) {
+				double first = matrix->batch->determinant[0];
+				sign = (first > 0) - (first < 0);
+				logDet = logl(fabsl((long double)first));
+				for (long b = 0; b < settings.batch; b++) {
+					double error = (double)fabsl((matrix->batch->determinant[b] - batchReference[b]) / batchReference[b]);
+					if (batchReference[b] != 0 && error > batch_error)
+						batch_error = error;
+				}
+				free(batchReference);
+			}
+			else
+				sign = log_determinant_Matrix(matrix, &logDet);
+			if (matrix->exact != NULL) {
+				size_t length = (size_t)matrix->exact->limbs * 20 + 2;
+				exactDet = (char*)malloc(length);
+				if (exactDet == NULL) {
+					perror("Memory allocation failed (determinant)");
+					exit(EXIT_FAILURE);
+				}
+				exact_determinant_Matrix(matrix, exactDet, length);
+			}
+			// Check the relative error, |det / correctDet - 1|, or 1 + |det / correctDet| for a wrong sign
+			if (sign == correctSign)
+				rel_error = fabsl(expm1l(logDet - correctLogDet));
+			else
+				rel_error = 1.0L + expl(logDet - correctLogDet);
+		#endif
+	}
+	
+	// Free the result buffer
+	if (matrix != NULL) {
+		free_Matrix(matrix);
+	}
+	#ifdef _DEBUG
+		//print_progress(100);
+		//print results (for vandermonde determinand increases very very VERY fast)
+		if (reference) {
+			printf("\nMy det: %+d * exp(%Lf) - Correct det: %+d * exp(%Lf)\n", sign, logDet, correctSign, correctLogDet);
+			printf("Relative error: %.10e\n", rel_error);
+		}
+		else {
+			printf("\nMy det: %+d * exp(%Lf)\n", sign, logDet);
+		}
+		if (exactDet != NULL) {
+			printf("Exact det: %s\n", exactDet);
+			free(exactDet);
+		}
+		if (settings.solve > 0)
+			printf("Solve residual (max over %d right-hand sides): %.10e\n", settings.solve, solve_residual);
+		if (settings.batch > 0)
+			printf("Batch relative error (max over %ld matrices): %.10e\n", settings.batch, batch_error);
+		printf("Matrix determination calculation completed.\n");
+	#endif
+}
+void displayMatrixSettings(SettingsMatrix settings) {
+	const char* model_name;
+
+	switch (settings.model) {
+	case 0: model_name = "dynamic"; break;
+	case 1: model_name = "tasking"; break;
+	case 2: model_name = "integrated"; break;
+	case 3: model_name = "dataflow"; break;
+	default: model_name = "unknown"; break;
+	}
+
+	printf("----- Settings -----\n");
+	printf("Size		: %d x %d\n", settings.size, settings.size);
+	printf("Vandermonde	: %d\n", settings.vandermonde);
+	printf("Prefab		: %d\n", settings.prefab);
+	printf("Thread count    : %d\n", settings.thread_num);
+	printf("Buffer size     : %d\n", settings.buffer_size);
+	printf("Parallel model  : %s\n", model_name);
+	if (settings.affinity)
+		printf("Affinity        : owner-computes queues\n");
+	printf("Random seed     : %u\n", settings.random);
+	if (settings.integers > 0)
+		printf("Integer range   : [-%d, %d]\n", settings.integers, settings.integers);
+	printf("Batch           : %ld\n", settings.batch);
+	if (settings.input != NULL)
+		printf("Input file      : %s\n", settings.input);
+	printf("Engine          : %s\n", engine_names[settings.engine]);
+	printf("Pivoting        : %s\n", settings.pivot ? "partial" : "none");
+	if (settings.engine == 1 || settings.solve > 0)
+		printf("Block size      : %d\n", settings.block);
+	if (settings.solve > 0)
+		printf("Right-hand sides: %d\n", settings.solve);
+	printf("--------------------\n");
+}
+void displayMatrixHelp() {
+	printf("Usage: MatrixDeterminant [options]\n");
+	printf("Options:\n");
+	printf("  -size <value>   Set the size of the matrix (default: 10)\n");
+	printf("  -vm <value>     Set the Vandermonde matrix flag (default: 1)\n");
+	printf("  -model <value>   Set the parallel model (0: dynamic, 1: tasking, 2: integrated, 3: dataflow, default: 0)\n");
+	printf("  -affinity <value> Dynamic model: every thread takes the packets of its own rows and tiles first (default: 0)\n");
+	printf("  -prefab <value>  Set the prefab matrix flag (default: 0)\n");
+	printf("  -random <value> Use a random matrix with the given seed, needs -vm 0 (default: 0 - off)\n");
+	printf("  -integers <value> Random matrix of integers in [-value, value] (default: 0 - reals in [-1, 1))\n");
+	printf("  -input <file>   Load the matrix, or the matrices of the batched mode, from a binary matrix file, needs -vm 0\n");
+	printf("                  (64 byte header, row-major doubles or floats; files written by -dump are used in place)\n");
+	printf("  -dump <file>    Write the matrix, or the matrices of the batched mode, to a binary matrix file\n");
+	printf("  -batch <value>  Compute the determinants of this many matrices of order -size, SIMD across matrices,\n");
+	printf("                  with its own kernel instead of -engine (default: 0 - one matrix)\n");
+	printf("  -pivot <value>  Set partial pivoting (0: off, 1: on, default: off for Vandermonde, on otherwise)\n");
+	printf("  -t <value>      Set the number of threads (default: 4)\n");
+	printf("  -bs <value>     Set the buffer size value (default: 512)\n");
+	printf("  -engine <value> Set the elimination engine (0: row by row, 1: blocked LU, 2: recursive LU,\n");
+	printf("                  3: exact Bareiss for integer matrices, default: 0)\n");
+	printf("  -simd <value>   Set the row update kernel (0: best supported, 1: generic, 2: AVX2 FMA, 3: AVX-512, default: 0)\n");
+	printf("  -nb <value>     Set the panel width and tile size of the blocked LU (default: 64)\n");
+	printf("  -solve <value>  Solve this many right-hand sides with the LU factors after the factorisation (default: 0)\n");
+	printf("  -report <value> Print the working time, GFLOP/s and energy (default: 0)\n");
+	printf("  -help           Display this help message\n");
+}
+// Merge Sort
+void runMergeSort(int argc, char** argv) {
+	SettingsSort settings;
+	settings.size = 1024;
+	settings.model = 0; // 0 - dynamic, 1 - tasking, 2 - integrated
+	settings.thread_num = 4;
+	settings.buffer_size = 512;
+	settings.affinity = 0;
+	settings.report = 0;
+	settings.pingpong = 0;
+	settings.simd = 0;
+	settings.algorithm = ALGO_MERGE_SORT;
+
+	for (int i = 0; i < argc; i += 2) {
+		if (!strcmp(argv[i], "-size")) {
+			settings.size = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-pingpong")) {
+			settings.pingpong = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-simd")) {
+			settings.simd = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-algo")) {
+			if (!strcmp(argv[i + 1], "merge")) {
+				settings.algorithm = ALGO_MERGE_SORT;
+			}
+			else if (!strcmp(argv[i + 1], "radix")) {
+				settings.algorithm = ALGO_RADIX_SORT;
+			}
+			else {
+				printf("Invalid algorithm: %s\n", argv[i + 1]);
+				exit(0);
+			}
+		}
+		else if (!strcmp(argv[i], "-report")) {
+			settings.report = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-t")) {
+			settings.thread_num = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-model")) {
+			settings.model = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-affinity")) {
+			settings.affinity = atoi(argv[i + 1]);
+		}
+		else if (!strcmp(argv[i], "-bs")) {
+			settings.buffer_size = atoi(argv[i + 1]);
+		}
+		else {
+			printf("Invalid argument: %s\n", argv[i]);
+			exit(0);
+		}
+	}
+	if (settings.affinity && settings.model != 0) {
+		printf("Affinity option is available for the dynamic model only.\n");
+		exit(0);
+	}
+	// Display the settings (once)
+	#ifdef _DEBUG
+		displayMergeSortSettings(settings);
+	#endif
+	// Allocate memory for the array (reverse order) ## worst case ##
+	t_energy_sample generation_before, generation_after;
+	read_energy(&generation_before);
+	double generation_time = omp_get_wtime();
+	int* array = generateArray(settings.size, settings.thread_num);
+	generation_time = omp_get_wtime() - generation_time;
+	read_energy(&generation_after);
+	g_array = array;
+	t_energy_sample energy_before, energy_after;
+	read_energy(&energy_before);
+	double time_before = omp_get_wtime();
+	// Run Merge Sort based on the selected model
+	switch (settings.model) {
+	case 0: dynamicForMergeSort(array, settings); break;
+	case 1: taskingMergeSort(array, settings); break;
+	case 2: integratedMasterMergeSort(array, settings); break;
+	default: printf("Bad model\n"); break;
+	}
+	double working_time = omp_get_wtime() - time_before;
+	read_energy(&energy_after);
+	if (settings.report) {
+		double energy = energy_between(&energy_before, &energy_after);
+		if (settings.algorithm == ALGO_RADIX_SORT)
+			printf("Algorithm       : LSD radix sort, %d passes of %d bits\n", RADIX_PASSES_SORT, RADIX_BITS_SORT);
+		else
+			printf("Leaf kernel     : %s\n", sort_kernel);
+		printf("Working time    : %.6f s\n", working_time);
+		printf("Throughput      : %.3f M elements/s\n", settings.size / working_time * 1e-6);
+		if (energy >= 0) {
+			printf("Energy          : %.6f J\n", energy);
+			printf("Energy/element  : %.3e J\n", energy / settings.size);
+		}
+		else {
+			printf("Energy          : n/a (RAPL counters not available)\n");
+		}
+		energy = energy_between(&generation_before, &generation_after);
+		if (energy >= 0)
+			printf("Generation      : %.6f s, %.6f J\n", generation_time, energy);
+		else
+			printf("Generation      : %.6f s\n", generation_time);
+		if (settings.affinity)
+			printf("Stolen packets  : %ld of %ld\n", affinity_stolen, affinity_packets);
+	}
+	#ifdef _DEBUG
+		print_progress(100);
+
+		//reverse order should now be sorted
+		printf("\nTesting correction...\n");
+		int flag = 0;
+		for (int i = 0; i < arraySize; i++) {
+			if (array[i] != i + 1) {
+				printf("Error: should be %d, is %d\nTesting terminated\n", i + 1, array[i]);
+				flag = 1;
+				break;
+			}
+		}
+		if (flag == 0) {
+			printf("Array sorted correctly.\n");
+		}
+		else {
+			printf("Array not sorted correctly.\n");
+		}
+	#endif
+	free(array);
+}
+void displayMergeSortSettings(SettingsSort settings) {
+	const char* model_name;
+
+	switch (settings.model) {
+	case 0: model_name = "dynamic"; break;
+	case 1: model_name = "tasking"; break;
+	case 2: model_name = "integrated"; break;
+	default: model_name = "unknown"; break;
+	}
+	// Display the settings
+	printf("----- Settings -----\n");
+	printf("Size		: %d\n", settings.size);
+	printf("Thread count    : %d\n", settings.thread_num);
+	printf("Buffer size     : %d\n", settings.buffer_size);
+	printf("Parallel model  : %s\n", model_name);
+	if (settings.affinity)
+		printf("Affinity        : owner-computes queues\n");
+	printf("Algorithm       : %s\n", settings.algorithm == ALGO_RADIX_SORT ? "LSD radix sort" : "merge sort");
+	printf("Merge buffers   : %s\n", settings.pingpong ? "ping-pong" : "scratch arenas");
+	printf("--------------------\n");
+}
+void displayMergeSortHelp() {
+	printf("Usage: MergeSort [options]\n");
+	printf("Options:\n");
+	printf("  -size <value>   Set the size of the array (default: 1000)\n");
+	printf("  -model <value>  Set the parallel model (0: dynamic, 1: tasking, 2: integrated, default: 0)\n");
+	printf("  -t <value>      Set the number of threads (default: 4)\n");
+	printf("  -bs <value>     Set the buffer size value (default: 512)\n");
+	printf("  -affinity <value> Dynamic model: every thread merges in its own part of the array first (default: 0)\n");
+	printf("  -algo <name>    Set the sorting algorithm (merge, radix - LSD radix sort of %d bit digits, default: merge)\n", RADIX_BITS_SORT);
+	printf("  -simd <value>   Set the leaf sort kernel for blocks of %d (0: best supported, 1: insertion sort, 2: AVX2 network, default: 0)\n", SORT_LEAF);
+	printf("  -pingpong <value> Merge between the array and a second buffer, no copy back (default: 0 - scratch arena per thread)\n");
+	printf("  -report <value> Print the working time, throughput and energy (default: 0)\n");
+	printf("  -help           Display this help message\n");
+}
+int* generateArray(int size, int threadnum) {
+	int* array = (int*)malloc(sizeof(int) * size);
+	if (array == NULL) {
+		perror("Memory allocation failed (array)");
+		exit(EXIT_FAILURE);
+	}
+	//first touch: every thread fills the contiguous part it sorts and merges first
+	#pragma omp parallel for schedule(static) num_threads(threadnum)
+	for (int i = 0; i < size; i++) {
+		array[i] = size - i;
+	}
+	return array;
+}
+